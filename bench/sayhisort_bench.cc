@@ -0,0 +1,277 @@
+#include "sayhisort.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "wikisort/WikiSort.h"
+
+// Included by GrailSort.h, which is included in namespaces below
+#include <malloc.h>
+#include <memory.h>
+
+namespace {
+
+//! Inputs are limited to this size in bytes, so that the largest cases fit in memory of ordinary machines
+constexpr std::size_t kMaxInputBytes = std::size_t{1} << 30;
+//! Short inputs are sorted in batches of at least this number of elements, to amortize the timer overhead.
+//! Each input in a batch is generated from a different seed, otherwise branch predictors would learn the input.
+constexpr std::size_t kMinBatchLen = std::size_t{1} << 16;
+
+/**
+ * @brief Element of `bytes` bytes, whose first 4 bytes are the sort key and the rest is payload.
+ */
+template <std::size_t bytes>
+struct Record {
+    std::uint32_t key;
+    std::array<unsigned char, bytes - sizeof(std::uint32_t)> payload;
+
+    friend bool operator<(const Record& lhs, const Record& rhs) { return lhs.key < rhs.key; }
+};
+
+template <std::size_t bytes>
+using Element = std::conditional_t<bytes == sizeof(std::uint32_t), std::uint32_t, Record<bytes>>;
+
+std::uint32_t& KeyOf(std::uint32_t& x) { return x; }
+
+template <std::size_t bytes>
+std::uint32_t& KeyOf(Record<bytes>& x) {
+    return x.key;
+}
+
+enum class Dist {
+    kRandom,
+    kSorted,
+    kReversed,
+    //! Ascending runs, each of which is 1/16 of the input
+    kSawtooth,
+    //! Ascending then descending
+    kOrganPipe,
+    //! 16 distinct keys
+    kFewUnique,
+    //! sqrt(n) distinct keys, which leaves `CollectKeys` just short of keys for the internal buffer
+    kSqrtUnique,
+};
+
+constexpr std::array kDists = {
+    std::pair{Dist::kRandom, "random"},
+    std::pair{Dist::kSorted, "sorted"},
+    std::pair{Dist::kReversed, "reversed"},
+    std::pair{Dist::kSawtooth, "sawtooth"},
+    std::pair{Dist::kOrganPipe, "organ_pipe"},
+    std::pair{Dist::kFewUnique, "few_unique"},
+    std::pair{Dist::kSqrtUnique, "sqrt_unique"},
+};
+
+std::vector<std::uint32_t> MakeKeys(Dist dist, std::size_t len, std::uint32_t seed) {
+    std::mt19937 rng{seed};
+    std::vector<std::uint32_t> keys(len);
+
+    switch (dist) {
+    case Dist::kRandom:
+        std::generate(keys.begin(), keys.end(), rng);
+        break;
+    case Dist::kSorted:
+        std::iota(keys.begin(), keys.end(), std::uint32_t{0});
+        break;
+    case Dist::kReversed:
+        std::iota(keys.rbegin(), keys.rend(), std::uint32_t{0});
+        break;
+    case Dist::kSawtooth: {
+        std::size_t tooth_len = std::max<std::size_t>(len / 16, 1);
+        for (std::size_t i = 0; i < len; ++i) {
+            keys[i] = static_cast<std::uint32_t>(i % tooth_len);
+        }
+        break;
+    }
+    case Dist::kOrganPipe:
+        for (std::size_t i = 0; i < len; ++i) {
+            keys[i] = static_cast<std::uint32_t>(std::min(i, len - 1 - i));
+        }
+        break;
+    case Dist::kFewUnique:
+        for (auto& key : keys) {
+            key = rng() % 16;
+        }
+        break;
+    case Dist::kSqrtUnique: {
+        auto num_unique = static_cast<std::size_t>(std::sqrt(static_cast<double>(len)));
+        for (std::size_t i = 0; i < len; ++i) {
+            keys[i] = static_cast<std::uint32_t>(i % num_unique);
+        }
+        std::shuffle(keys.begin(), keys.end(), rng);
+        break;
+    }
+    }
+    return keys;
+}
+
+//
+// Third-party sorts
+//
+
+//! `SORT_CMP` of GrailSort
+template <typename T>
+int GrailCompare(const T* lhs, const T* rhs) {
+    return *lhs < *rhs ? -1 : *rhs < *lhs ? 1 : 0;
+}
+
+// GrailSort is generic by macros, so it's included once for each element type, in its own namespace
+#define SORT_TYPE GrailElement
+#define SORT_CMP(x, y) GrailCompare(x, y)
+
+namespace grail_4b {
+using GrailElement = Element<4>;
+#include "grailsort/GrailSort.h"
+}  // namespace grail_4b
+
+namespace grail_16b {
+using GrailElement = Element<16>;
+#include "grailsort/GrailSort.h"
+}  // namespace grail_16b
+
+namespace grail_64b {
+using GrailElement = Element<64>;
+#include "grailsort/GrailSort.h"
+}  // namespace grail_64b
+
+namespace grail_256b {
+using GrailElement = Element<256>;
+#include "grailsort/GrailSort.h"
+}  // namespace grail_256b
+
+#undef SORT_TYPE
+#undef SORT_CMP
+
+using grail_16b::GrailSort;
+using grail_256b::GrailSort;
+using grail_4b::GrailSort;
+using grail_64b::GrailSort;
+
+enum class Algo {
+    kSayhiSort,
+    //! Block merge sort, which `sayhisort::sort` bypasses for integers
+    kSayhiBlockMergeSort,
+    kSayhiAdaptiveSort,
+    kStdStableSort,
+    kStdSort,
+    //! In-place GrailSort, without its optional external buffer
+    kGrailSort,
+    kWikiSort,
+};
+
+constexpr std::array kAlgos = {
+    std::pair{Algo::kSayhiSort, "sayhisort::sort"},
+    std::pair{Algo::kSayhiBlockMergeSort, "sayhisort::sort(block_merge)"},
+    std::pair{Algo::kSayhiAdaptiveSort, "sayhisort::adaptive_sort"},
+    std::pair{Algo::kStdStableSort, "std::stable_sort"},
+    std::pair{Algo::kStdSort, "std::sort"},
+    std::pair{Algo::kGrailSort, "GrailSort"},
+    std::pair{Algo::kWikiSort, "WikiSort"},
+};
+
+template <typename Iterator>
+void SortBy(Algo algo, Iterator first, Iterator last) {
+    switch (algo) {
+    case Algo::kSayhiSort:
+        return sayhisort::sort(first, last);
+    case Algo::kSayhiBlockMergeSort:
+        return sayhisort::detail::Sort(first, last, std::less<>{});
+    case Algo::kSayhiAdaptiveSort:
+        return sayhisort::adaptive_sort(first, last);
+    case Algo::kStdStableSort:
+        return std::stable_sort(first, last);
+    case Algo::kStdSort:
+        return std::sort(first, last);
+    case Algo::kGrailSort:
+        return GrailSort(std::addressof(*first), static_cast<int>(last - first));
+    case Algo::kWikiSort:
+        return Wiki::Sort(first, last, std::less<>{});
+    }
+}
+
+template <std::size_t bytes>
+void BM_Sort(benchmark::State& state, Algo algo, Dist dist) {
+    using T = Element<bytes>;
+    auto len = static_cast<std::size_t>(state.range(0));
+    std::size_t batch = std::max<std::size_t>(kMinBatchLen / len, 1);
+
+    std::vector<T> input(len * batch);
+    for (std::size_t i = 0; i < batch; ++i) {
+        std::vector<std::uint32_t> keys = MakeKeys(dist, len, static_cast<std::uint32_t>(i));
+        for (std::size_t j = 0; j < len; ++j) {
+            KeyOf(input[i * len + j]) = keys[j];
+        }
+    }
+    std::vector<T> data(len * batch);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::copy(input.begin(), input.end(), data.begin());
+        state.ResumeTiming();
+
+        for (std::size_t i = 0; i < batch; ++i) {
+            SortBy(algo, data.begin() + i * len, data.begin() + (i + 1) * len);
+        }
+        benchmark::ClobberMemory();
+    }
+
+    for (std::size_t i = 0; i < batch; ++i) {
+        if (!std::is_sorted(data.begin() + i * len, data.begin() + (i + 1) * len)) {
+            state.SkipWithError("not sorted");
+            break;
+        }
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * batch * len));
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * batch * len * sizeof(T)));
+}
+
+template <std::size_t bytes>
+void RegisterSorts() {
+    // Integers are sorted by an unstable quick sort, so the stable block merge sort gets its own row for them
+    using Iterator = typename std::vector<Element<bytes>>::iterator;
+    constexpr bool unstable = sayhisort::detail::kIsStabilityUnobservable<Iterator, std::less<>>;
+    for (auto [algo, algo_name] : kAlgos) {
+        if (algo == Algo::kSayhiBlockMergeSort && !unstable) {
+            continue;
+        }
+        std::string label = algo == Algo::kSayhiSort && unstable ? "sayhisort::sort(unstable)" : algo_name;
+        for (auto [dist, dist_name] : kDists) {
+            std::string name = label + "/" + dist_name + "/" + std::to_string(bytes) + "B";
+            auto* bm = benchmark::RegisterBenchmark(name.c_str(), BM_Sort<bytes>, algo, dist);
+            for (std::size_t len = 100; len <= 100'000'000 && len * bytes <= kMaxInputBytes; len *= 10) {
+                bm->Arg(static_cast<std::int64_t>(len));
+            }
+            bm->Unit(benchmark::kMicrosecond);
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    RegisterSorts<4>();
+    RegisterSorts<16>();
+    RegisterSorts<64>();
+    RegisterSorts<256>();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,440 @@
+// Microbenchmarks of the subroutines in sayhisort::detail, with hardware counters per element.
+//
+// Counters are read by Linux perf_event_open(2). If it's unavailable (e.g. perf_event_paranoid is too strict, or on
+// virtual machines without PMU), only timings are reported.
+
+#include "sayhisort.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using namespace sayhisort::detail;
+
+using Iterator = std::vector<int>::iterator;
+using Compare = std::less<int>;
+using SsizeT = Iterator::difference_type;
+
+//
+// Hardware counters
+//
+
+/**
+ * @brief Counts hardware events of the calling thread in user space, while the kernel under measurement is running.
+ *
+ * Each event is opened individually, so that events not supported by the CPU are just skipped.
+ */
+class PerfCounters {
+public:
+    struct Event {
+        const char* name;
+        std::uint32_t type;
+        std::uint64_t config;
+    };
+
+    static constexpr std::array<Event, 5> kEvents = {{
+#ifdef __linux__
+        {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {"l1d_misses", PERF_TYPE_HW_CACHE,
+         PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {"llc_misses", PERF_TYPE_HW_CACHE,
+         PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+#else
+        {"cycles", 0, 0},
+        {"instructions", 0, 0},
+        {"branch_misses", 0, 0},
+        {"l1d_misses", 0, 0},
+        {"llc_misses", 0, 0},
+#endif
+    }};
+
+    static PerfCounters& Get() {
+        static PerfCounters counters;
+        return counters;
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    /**
+     * @brief Start a measurement, which lasts until `Stop()` is called.
+     */
+    void Start() { Read(start_); }
+
+    /**
+     * @brief Stop the measurement and accumulate counts into `totals`.
+     */
+    void Stop(std::array<std::uint64_t, kEvents.size()>& totals) {
+        std::array<std::uint64_t, kEvents.size()> stop{};
+        Read(stop);
+        for (std::size_t i = 0; i < kEvents.size(); ++i) {
+            totals[i] += stop[i] - start_[i];
+        }
+    }
+
+    /**
+     * @brief Report accumulated counts as averages per element per iteration.
+     */
+    void Report(benchmark::State& state, const std::array<std::uint64_t, kEvents.size()>& totals,
+                SsizeT num_elems) const {
+        for (std::size_t i = 0; i < kEvents.size(); ++i) {
+            if (fds_[i] >= 0) {
+                double per_elem = static_cast<double>(totals[i]) / static_cast<double>(num_elems);
+                state.counters[kEvents[i].name] = benchmark::Counter(per_elem, benchmark::Counter::kAvgIterations);
+            }
+        }
+    }
+
+private:
+    PerfCounters() {
+        bool any_opened = false;
+        for (std::size_t i = 0; i < kEvents.size(); ++i) {
+            fds_[i] = Open(kEvents[i]);
+            any_opened |= fds_[i] >= 0;
+        }
+        if (!any_opened) {
+            std::fprintf(stderr, "perf_event_open is unavailable; hardware counters aren't reported\n");
+        }
+    }
+
+    static int Open(const Event& event) {
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = event.type;
+        attr.config = event.config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+        (void)event;
+        return -1;
+#endif
+    }
+
+    void Read(std::array<std::uint64_t, kEvents.size()>& values) const {
+        for (std::size_t i = 0; i < kEvents.size(); ++i) {
+            values[i] = 0;
+#ifdef __linux__
+            if (fds_[i] >= 0 && read(fds_[i], &values[i], sizeof(values[i])) != sizeof(values[i])) {
+                values[i] = 0;
+            }
+#endif
+        }
+    }
+
+    std::array<int, kEvents.size()> fds_{};
+    std::array<std::uint64_t, kEvents.size()> start_{};
+};
+
+/**
+ * @brief Run `kernel` in the benchmark loop, after `setup` for each iteration, reporting counters per element.
+ */
+template <typename Setup, typename Kernel>
+void Measure(benchmark::State& state, SsizeT num_elems, Setup setup, Kernel kernel) {
+    PerfCounters& counters = PerfCounters::Get();
+    std::array<std::uint64_t, PerfCounters::kEvents.size()> totals{};
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        setup();
+        state.ResumeTiming();
+
+        counters.Start();
+        kernel();
+        counters.Stop(totals);
+        benchmark::ClobberMemory();
+    }
+
+    counters.Report(state, totals, num_elems);
+    state.SetItemsProcessed(state.iterations() * num_elems);
+}
+
+//
+// Input generation
+//
+
+std::vector<int> RandomInts(SsizeT len, int max_value, std::mt19937& rng) {
+    std::vector<int> v(static_cast<std::size_t>(len));
+    std::uniform_int_distribution<int> dist{0, max_value};
+    std::generate(v.begin(), v.end(), [&]() { return dist(rng); });
+    return v;
+}
+
+/**
+ * @brief Fill [first, last) with two sorted sequences split at `middle`, whose elements are drawn from the same range
+ */
+void FillSortedPair(Iterator first, Iterator middle, Iterator last, std::mt19937& rng) {
+    // Sorted sequences are generated directly by random increments, as sorting them could take longer than kernels
+    auto fill_sorted = [&rng](Iterator seq, Iterator seq_last, SsizeT total_len) {
+        SsizeT max_step = 2 * total_len / std::max<SsizeT>(seq_last - seq, 1);
+        std::uniform_int_distribution<SsizeT> step{0, max_step};
+        SsizeT x = 0;
+        for (; seq != seq_last; ++seq) {
+            x += step(rng);
+            *seq = static_cast<int>(x);
+        }
+    };
+    fill_sorted(first, middle, last - first);
+    fill_sorted(middle, last, last - first);
+}
+
+//
+// Benchmarks
+//
+
+void BM_Rotate(benchmark::State& state) {
+    SsizeT len = state.range(0);
+    SsizeT l_len = len / state.range(1);
+    std::vector<int> data(static_cast<std::size_t>(len));
+    std::iota(data.begin(), data.end(), 0);
+
+    Measure(
+        state, len, []() {}, [&]() { Rotate(data.begin(), data.begin() + l_len, data.end()); });
+}
+
+void BM_BinarySearch(benchmark::State& state) {
+    constexpr SsizeT kNumKeys = 1024;
+    SsizeT len = state.range(0);
+    std::mt19937 rng{42};
+    std::vector<int> data = RandomInts(len, static_cast<int>(len), rng);
+    std::sort(data.begin(), data.end());
+    std::vector<int> keys = RandomInts(kNumKeys, static_cast<int>(len), rng);
+
+    Measure(
+        state, kNumKeys, []() {},
+        [&]() {
+            for (Iterator key = keys.begin(); key != keys.end(); ++key) {
+                benchmark::DoNotOptimize(BinarySearch<false>(data.begin(), data.end(), key, Compare{}));
+            }
+        });
+}
+
+template <typename MergeCompare>
+void BM_MergeWithBuf(benchmark::State& state) {
+    SsizeT len = state.range(0);
+    std::mt19937 rng{42};
+    std::vector<int> data(static_cast<std::size_t>(len * 3));
+
+    Measure(
+        state, len * 2, [&]() { FillSortedPair(data.begin() + len, data.begin() + len * 2, data.end(), rng); },
+        [&]() {
+            Iterator buf = data.begin();
+            benchmark::DoNotOptimize(
+                MergeWithBuf<false>(buf, buf + len, buf + len * 2, data.end(), MergeCompare{}).rest);
+        });
+}
+
+//! Comparator not seen as cheap, which takes the cross merge in `MergeWithBuf`
+struct OpaqueCompare {
+    bool operator()(int x, int y) const { return x < y; }
+};
+
+template <SearchKind search>
+void BM_MergeWithoutBuf(benchmark::State& state) {
+    // Like merging collected keys back into the data, xs is short and consists of unique keys
+    SsizeT len = state.range(0);
+    SsizeT xs_len = OverApproxSqrt(len);
+    std::mt19937 rng{42};
+    std::vector<int> data(static_cast<std::size_t>(xs_len + len));
+
+    Measure(
+        state, xs_len + len,
+        [&]() {
+            FillSortedPair(data.begin(), data.begin() + xs_len, data.end(), rng);
+            for (SsizeT i = 0; i < xs_len; ++i) {
+                data[static_cast<std::size_t>(i)] = static_cast<int>(i * len / xs_len);
+            }
+        },
+        [&]() { MergeWithoutBuf<false, search>(data.begin(), data.begin() + xs_len, data.end(), Compare{}); });
+}
+
+template <SearchKind search>
+void BM_MergeWithoutBufFewUnique(benchmark::State& state) {
+    // Like merging blocks at levels without buffer, which happen only if data has few distinct keys
+    SsizeT len = state.range(0);
+    std::mt19937 rng{42};
+    std::vector<int> data;
+
+    Measure(
+        state, len,
+        [&]() {
+            data = RandomInts(len, 15, rng);
+            std::sort(data.begin(), data.begin() + len / 2);
+            std::sort(data.begin() + len / 2, data.end());
+        },
+        [&]() { MergeWithoutBuf<false, search>(data.begin(), data.begin() + len / 2, data.end(), Compare{}); });
+}
+
+void BM_InplaceMerge(benchmark::State& state) {
+    SsizeT len = state.range(0);
+    std::mt19937 rng{42};
+    std::vector<int> data(static_cast<std::size_t>(len));
+
+    Measure(
+        state, len, [&]() { FillSortedPair(data.begin(), data.begin() + len / 2, data.end(), rng); },
+        [&]() { InplaceMerge(data.begin(), data.begin() + len / 2, data.end(), Compare{}); });
+}
+
+template <typename PartitionCompare>
+void BM_PartitionBranchless(benchmark::State& state) {
+    // Builtin comparison takes SIMD partitioning if the CPU supports it, and the opaque one the scalar loop
+    SsizeT len = state.range(0);
+    std::mt19937 rng{42};
+    std::vector<int> data;
+
+    Measure(
+        state, len, [&]() { data = RandomInts(len, std::numeric_limits<int>::max(), rng); },
+        [&]() {
+            benchmark::DoNotOptimize(PartitionBranchless<false>(data.begin(), data.end(), PartitionCompare{}));
+        });
+}
+
+void BM_InterleaveBlocks(benchmark::State& state) {
+    // [imitation buffer | left blocks | right blocks], where blocks are as many as their length
+    SsizeT num_blocks = state.range(0);
+    SsizeT block_len = num_blocks;
+    std::mt19937 rng{42};
+    std::vector<int> data(static_cast<std::size_t>(num_blocks * (block_len + 1)));
+    Iterator imit = data.begin();
+    Iterator blocks = imit + num_blocks;
+
+    Measure(
+        state, num_blocks * block_len,
+        [&]() {
+            std::iota(imit, blocks, 0);
+            FillSortedPair(blocks, blocks + num_blocks / 2 * block_len, data.end(), rng);
+        },
+        [&]() { benchmark::DoNotOptimize(InterleaveBlocks(imit, blocks, num_blocks, block_len, Compare{})); });
+}
+
+template <bool with_buf>
+void BM_DeinterleaveImitation(benchmark::State& state) {
+    // Imitation buffer as left by `InterleaveBlocks`: keys from left and right, randomly interleaved
+    SsizeT imit_len = state.range(0);
+    std::mt19937 rng{42};
+    std::vector<int> data(static_cast<std::size_t>(imit_len + imit_len / 2));
+    Iterator imit = data.begin();
+    Iterator buf = imit + imit_len;
+    Iterator mid_key;
+
+    Measure(
+        state, imit_len,
+        [&]() {
+            int left_key = 0;
+            int right_key = static_cast<int>(imit_len / 2);
+            for (Iterator key = imit; key != buf; ++key) {
+                bool take_left = right_key == imit_len || (left_key < imit_len / 2 && rng() % 2);
+                *key = take_left ? left_key++ : right_key++;
+                if (*key == imit_len / 2) {
+                    mid_key = key;
+                }
+            }
+        },
+        [&]() {
+            if constexpr (with_buf) {
+                DeinterleaveImitation(imit, imit_len, buf, mid_key, Compare{});
+            } else {
+                DeinterleaveImitation(imit, imit_len, mid_key, Compare{});
+            }
+        });
+}
+
+void BM_ShellSort(benchmark::State& state) {
+    SsizeT len = state.range(0);
+    std::mt19937 rng{42};
+    std::vector<int> data;
+
+    Measure(
+        state, len, [&]() { data = RandomInts(len, std::numeric_limits<int>::max(), rng); },
+        [&]() { ShellSort(data.begin(), len, Compare{}); });
+}
+
+void BM_CollectKeys(benchmark::State& state) {
+    SsizeT len = state.range(0);
+    SsizeT num_desired_keys = OverApproxSqrt(len) * 2;
+    std::mt19937 rng{42};
+    std::vector<int> data;
+
+    Measure(
+        state, len, [&]() { data = RandomInts(len, static_cast<int>(len), rng); },
+        [&]() { benchmark::DoNotOptimize(CollectKeys(data.begin(), data.end(), num_desired_keys, Compare{})); });
+}
+
+BENCHMARK(BM_Rotate)->ArgsProduct({{1 << 10, 1 << 16, 1 << 22}, {2, 3, 64}});
+BENCHMARK(BM_BinarySearch)->RangeMultiplier(16)->Range(1 << 4, 1 << 20);
+BENCHMARK(BM_MergeWithBuf<Compare>)->Name("BM_MergeWithBuf/less")->RangeMultiplier(16)->Range(1 << 4, 1 << 16);
+BENCHMARK(BM_MergeWithBuf<OpaqueCompare>)->Name("BM_MergeWithBuf/opaque")->RangeMultiplier(16)->Range(1 << 4, 1 << 16);
+BENCHMARK(BM_MergeWithoutBuf<SearchKind::kBinary>)
+    ->Name("BM_MergeWithoutBuf/binary")
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_MergeWithoutBuf<SearchKind::kExponential>)
+    ->Name("BM_MergeWithoutBuf/exponential")
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_MergeWithoutBuf<SearchKind::kHwangLin>)
+    ->Name("BM_MergeWithoutBuf/hwang_lin")
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_MergeWithoutBufFewUnique<SearchKind::kBinary>)
+    ->Name("BM_MergeWithoutBufFewUnique/binary")
+    ->RangeMultiplier(4)
+    ->Range(1 << 6, 1 << 12);
+BENCHMARK(BM_MergeWithoutBufFewUnique<SearchKind::kExponential>)
+    ->Name("BM_MergeWithoutBufFewUnique/exponential")
+    ->RangeMultiplier(4)
+    ->Range(1 << 6, 1 << 12);
+BENCHMARK(BM_InplaceMerge)->RangeMultiplier(16)->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_PartitionBranchless<Compare>)
+    ->Name("BM_PartitionBranchless/less")
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_PartitionBranchless<OpaqueCompare>)
+    ->Name("BM_PartitionBranchless/opaque")
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_InterleaveBlocks)->RangeMultiplier(4)->Range(1 << 4, 1 << 10);
+BENCHMARK(BM_DeinterleaveImitation<true>)
+    ->Name("BM_DeinterleaveImitation/buf")
+    ->RangeMultiplier(4)
+    ->Range(1 << 4, 1 << 12);
+BENCHMARK(BM_DeinterleaveImitation<false>)
+    ->Name("BM_DeinterleaveImitation/in_place")
+    ->RangeMultiplier(4)
+    ->Range(1 << 4, 1 << 12);
+BENCHMARK(BM_ShellSort)->RangeMultiplier(4)->Range(1 << 4, 1 << 10);
+BENCHMARK(BM_CollectKeys)->RangeMultiplier(16)->Range(1 << 8, 1 << 20);
+
+}  // namespace
+
+BENCHMARK_MAIN();
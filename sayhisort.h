@@ -10,13 +10,128 @@
 #define SAYHISORT_CONSTEXPR_SWAP
 #endif
 
+// With GCC or Clang on x86-64, SIMD kernels are compiled for each instruction set, and the best one for the CPU is
+// picked at run time. Define SAYHISORT_NO_RUNTIME_DISPATCH to use only the instruction sets enabled for the target.
+#if !defined(SAYHISORT_NO_RUNTIME_DISPATCH) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SAYHISORT_RUNTIME_DISPATCH 1
+#else
+#define SAYHISORT_RUNTIME_DISPATCH 0
+#endif
+
+#if SAYHISORT_RUNTIME_DISPATCH
+// Kernels are compiled for the instruction set given by the attribute rather than the target. The generic parts of
+// kernels are inlined into entry functions with the attribute by flattening; since that doesn't happen at -O0,
+// registers are passed to the operations by reference only, whose ABI doesn't depend on the instruction set.
+#define SAYHISORT_TARGET(isa) __attribute__((target(isa)))
+#define SAYHISORT_FLATTEN __attribute__((flatten))
+#else
+#define SAYHISORT_TARGET(isa)
+#define SAYHISORT_FLATTEN
+#endif
+
+// Sorting networks for leaf sequences and searches are vectorized when dispatched at run time, or the target supports
+// either of the instruction sets.
+#if SAYHISORT_RUNTIME_DISPATCH || defined(__AVX2__) || defined(__SSE4_1__)
+#define SAYHISORT_HAS_SIMD_LEAVES 1
+#else
+#define SAYHISORT_HAS_SIMD_LEAVES 0
+#endif
+
+// Maximum length of leaf sequences sorted by the vectorized sorting networks; either of 8, 16, or 32.
+#ifndef SAYHISORT_SIMD_LEAF_LEN
+#define SAYHISORT_SIMD_LEAF_LEN 32
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <tuple>
 #include <type_traits>
 #include <utility>
+#include <vector>
+
+#if SAYHISORT_HAS_SIMD_LEAVES
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if __cpp_lib_ranges >= 201911L
+#include <ranges>
+#endif
 
 namespace sayhisort {
 
+/**
+ * @brief Counters of the work done by a sort, which are accumulated when passed to `sort`.
+ *
+ * Comparisons are counted exactly. Swaps are counted per element for swaps of blocks and for rotations, whereas single
+ * swaps in merge loops aren't, as they are one per merged element. Without the counters, no code counts anything.
+ *
+ * Sorts with the counters take the same code paths as those without, so integers compared by `std::less` or
+ * `std::greater` are counted in the unstable quick sort.
+ */
+struct sort_stats {
+    //! Calls of the comparator
+    std::uint64_t comparisons = 0;
+    //! Elements moved by swaps of blocks and by rotations
+    std::uint64_t swaps = 0;
+    //! Calls of rotation
+    std::uint64_t rotations = 0;
+    //! Keys collected for the imitation buffer and the internal buffer
+    std::uint64_t collected_keys = 0;
+    //! Merge levels done with the internal or an external buffer
+    std::uint64_t buffered_levels = 0;
+    //! Merge levels done without buffer, by rotations
+    std::uint64_t unbuffered_levels = 0;
+    //! Merge levels skipped, since data had so few distinct keys that it was sorted without block merging
+    std::uint64_t skipped_levels = 0;
+    //! Partitions by the unstable quick sort
+    std::uint64_t partitions = 0;
+};
+
+/**
+ * @brief Phases of `sort`, which are reported to a phase listener passed to it.
+ */
+enum class sort_phase {
+    //! Collecting distinct keys for the imitation buffer and the internal buffer
+    collect_keys,
+    //! Sorting data of few distinct keys, which replaces all the following phases
+    sort_few_unique,
+    //! Sorting short sequences at the bottom of merge sort
+    sort_leaves,
+    //! Merging each pair of adjacent sequences at one level of merge sort
+    merge_level,
+    //! Sorting the internal buffer after it's dropped, and merging it with the imitation buffer
+    redistribute_buffer,
+    //! Merging the collected keys with the sorted data
+    merge_keys,
+    //! Sorting integers compared by `std::less` or `std::greater` by the unstable quick sort, which replaces all the
+    //! other phases
+    quick_sort,
+};
+
+/**
+ * @brief Parameters of a phase of `sort`, given at its beginning.
+ */
+struct sort_phase_info {
+    //! Number of elements processed by the phase
+    std::ptrdiff_t len = 0;
+    //! Length of sequences merged in pairs, or of leaf sequences; otherwise 0
+    std::ptrdiff_t seq_len = 0;
+    //! Number of blocks of each pair of sequences in block merging; otherwise 0
+    std::ptrdiff_t num_blocks = 0;
+    //! Length of blocks in block merging; otherwise 0
+    std::ptrdiff_t block_len = 0;
+    //! Whether merging is done with the internal or an external buffer
+    bool buffered = false;
+};
+
 namespace detail {
 namespace {
 
@@ -55,9 +170,300 @@ constexpr SsizeT OverApproxSqrt(SsizeT x) {
     return (r + (x - 1) / r) / 2 + 1;
 }
 
+/**
+ * @brief Whether `Iterator` is known to point a contiguous storage, so that it can be converted to a raw pointer.
+ */
+template <typename Iterator, typename T = typename std::iterator_traits<Iterator>::value_type>
+constexpr bool kIsContiguousIterator =
+#if __cpp_lib_concepts >= 202002L
+    std::contiguous_iterator<Iterator> ||
+#endif
+    std::is_pointer_v<Iterator> || std::is_same_v<Iterator, typename std::vector<T>::iterator>;
+
+/**
+ * @brief Whether the code is being evaluated at compile time; always false before C++20.
+ *
+ * Code paths relying on non-constexpr facilities such as SIMD intrinsics must be guarded by this.
+ */
+constexpr bool IsConstantEvaluated() {
+#if __cpp_lib_is_constant_evaluated >= 201811L
+    return std::is_constant_evaluated();
+#else
+    return false;
+#endif
+}
+
+template <typename Iterator>
+struct IsReverseIterator : std::false_type {};
+
+template <typename Iterator>
+struct IsReverseIterator<std::reverse_iterator<Iterator>> : std::true_type {};
+
+template <typename Iterator, typename... Iterators>
+struct ZipIterator;
+
+template <typename Iterator>
+struct IsZipIterator : std::false_type {};
+
+template <typename... Iterators>
+struct IsZipIterator<ZipIterator<Iterators...>> : std::true_type {};
+
+/**
+ * @brief Call `fn` for each column of zip iterators, with the iterators of the column.
+ */
+template <typename Fn, typename Zip, typename... Zips>
+SAYHISORT_CONSTEXPR_SWAP void ForEachColumn(Fn fn, Zip zip, Zips... zips);
+
+/**
+ * @brief Whether elements in ranges of `Iterator1` and `Iterator2` can be swapped by copying their bytes.
+ *
+ * Elements of odd sizes are excluded, as chunks of them don't map well to vector registers and swapping them one by
+ * one turns out to be faster.
+ */
+template <typename Iterator1, typename Iterator2,
+          typename T1 = std::remove_cv_t<typename std::iterator_traits<Iterator1>::value_type>,
+          typename T2 = std::remove_cv_t<typename std::iterator_traits<Iterator2>::value_type>>
+constexpr bool kIsMemSwappable = std::is_trivially_copyable_v<T1> && std::is_same_v<T1, T2> &&
+                                 (sizeof(T1) & (sizeof(T1) - 1)) == 0 && kIsContiguousIterator<Iterator1> &&
+                                 kIsContiguousIterator<Iterator2>;
+
+//! Size of chunks swapped through a temporary buffer. Ranges shorter than this are swapped element by element.
+constexpr std::size_t kSwapChunkBytes = 64;
+
+/**
+ * @brief Swap elements of two ranges by copying bytes through a temporary buffer.
+ *
+ * @tparam forward
+ *   If true, it's equivalent to `for i in [0, len): swap(a[i], b[i])`.
+ *   Otherwise, `a` and `b` point the ends of the ranges, and it's equivalent to
+ *   `for i in [1, len]: swap(a[-i], b[-i])`.
+ *   The ranges may overlap. If they are closer than a chunk, elements are swapped one by one to keep the order of the
+ *   equivalent loop.
+ * @param a
+ * @param b
+ * @param len
+ */
+template <bool forward, typename T>
+void SwapMemory(T* a, T* b, std::size_t len) {
+    constexpr std::size_t kChunkLen = kSwapChunkBytes / sizeof(T) ? kSwapChunkBytes / sizeof(T) : 1;
+
+    auto pa = reinterpret_cast<std::uintptr_t>(a);
+    auto pb = reinterpret_cast<std::uintptr_t>(b);
+    std::size_t dist = (pa < pb ? pb - pa : pa - pb) / sizeof(T);
+
+    if (dist >= kChunkLen || dist >= len) {
+        alignas(T) unsigned char tmp[kChunkLen * sizeof(T)];
+        for (; len >= kChunkLen; len -= kChunkLen) {
+            if constexpr (!forward) {
+                a -= kChunkLen;
+                b -= kChunkLen;
+            }
+            std::memcpy(tmp, a, sizeof(tmp));
+            std::memcpy(a, b, sizeof(tmp));
+            std::memcpy(b, tmp, sizeof(tmp));
+            if constexpr (forward) {
+                a += kChunkLen;
+                b += kChunkLen;
+            }
+        }
+    }
+
+    for (; len; --len) {
+        if constexpr (forward) {
+            swap(*a++, *b++);
+        } else {
+            swap(*--a, *--b);
+        }
+    }
+}
+
+template <typename Iterator1, typename Iterator2>
+SAYHISORT_CONSTEXPR_SWAP void SwapRangesBackward(Iterator1 a_last, Iterator2 b_last, diff_t<Iterator1> len);
+
+/**
+ * @brief Swap elements of two ranges, as `for i in [0, len): swap(a[i], b[i])`. The ranges may overlap.
+ *
+ * Ranges of trivially copyable types in contiguous storage are swapped in bulk by `SwapMemory`.
+ *
+ * @param a
+ * @param b
+ * @param len
+ *   @pre len >= 0
+ */
+template <typename Iterator1, typename Iterator2>
+SAYHISORT_CONSTEXPR_SWAP void SwapRanges(Iterator1 a, Iterator2 b, diff_t<Iterator1> len) {
+    if constexpr (IsReverseIterator<Iterator1>::value && IsReverseIterator<Iterator2>::value) {
+        return SwapRangesBackward(a.base(), b.base(), len);
+    } else if constexpr (IsZipIterator<Iterator1>::value && std::is_same_v<Iterator1, Iterator2>) {
+        // Columns are swapped one by one, so that each of them may be swapped in bulk
+        return ForEachColumn([len](auto a_col, auto b_col) { SwapRanges(a_col, b_col, len); }, a, b);
+    } else {
+        if constexpr (kIsMemSwappable<Iterator1, Iterator2>) {
+            using T = typename std::iterator_traits<Iterator1>::value_type;
+            if (!IsConstantEvaluated() && static_cast<std::size_t>(len) * sizeof(T) >= kSwapChunkBytes) {
+                return SwapMemory<true>(std::addressof(*a), std::addressof(*b), static_cast<std::size_t>(len));
+            }
+        }
+        for (; len > 0; --len) {
+            swap(*a++, *b++);
+        }
+    }
+}
+
+/**
+ * @brief Swap elements of two ranges backward, as `for i in [1, len]: swap(a_last[-i], b_last[-i])`.
+ *
+ * @param a_last
+ * @param b_last
+ * @param len
+ *   @pre len >= 0
+ */
+template <typename Iterator1, typename Iterator2>
+SAYHISORT_CONSTEXPR_SWAP void SwapRangesBackward(Iterator1 a_last, Iterator2 b_last, diff_t<Iterator1> len) {
+    if constexpr (IsReverseIterator<Iterator1>::value && IsReverseIterator<Iterator2>::value) {
+        return SwapRanges(a_last.base(), b_last.base(), len);
+    } else if constexpr (IsZipIterator<Iterator1>::value && std::is_same_v<Iterator1, Iterator2>) {
+        return ForEachColumn([len](auto a_col, auto b_col) { SwapRangesBackward(a_col, b_col, len); }, a_last,
+                             b_last);
+    } else {
+        if constexpr (kIsMemSwappable<Iterator1, Iterator2>) {
+            using T = typename std::iterator_traits<Iterator1>::value_type;
+            if (!IsConstantEvaluated() && static_cast<std::size_t>(len) * sizeof(T) >= kSwapChunkBytes) {
+                return SwapMemory<false>(std::addressof(*(a_last - 1)) + 1, std::addressof(*(b_last - 1)) + 1,
+                                         static_cast<std::size_t>(len));
+            }
+        }
+        for (; len > 0; --len) {
+            swap(*--a_last, *--b_last);
+        }
+    }
+}
+
+/**
+ * @brief Whether elements of `Iterator` are relocated by moves through a temporary "hole" rather than by swaps.
+ *
+ * A swap costs three moves, whereas a chain of relocations through a hole costs one move per element plus two.
+ * Trivially copyable types are excluded, as their swaps are as cheap as moves.
+ */
+template <typename Iterator, typename T = std::remove_cv_t<typename std::iterator_traits<Iterator>::value_type>>
+constexpr bool kIsHoleMovable = !std::is_trivially_copyable_v<T> && std::is_nothrow_move_constructible_v<T> &&
+                                std::is_nothrow_move_assignable_v<T>;
+
+/**
+ * @brief Cyclically shift values at the given positions, as `x0 <- x1 <- ... <- xn <- x0`.
+ *
+ * @param x0
+ * @param xs
+ *   @pre All positions are distinct
+ */
+template <typename Iterator, typename... Iterators>
+SAYHISORT_CONSTEXPR_SWAP void RotateValues(Iterator x0, Iterators... xs) {
+    Iterator prev = x0;
+    if constexpr (kIsHoleMovable<Iterator>) {
+        typename std::iterator_traits<Iterator>::value_type tmp = std::move(*x0);
+        ((*prev = std::move(*xs), prev = xs), ...);
+        *prev = std::move(tmp);
+    } else {
+        ((swap(*prev, *xs), prev = xs), ...);
+    }
+}
+
+/**
+ * @brief Rotate two chunks split at `middle` by the trinity rotation, a.k.a. conjoined triple reversal
+ *
+ * Description available: https://github.com/scandum/rotate#trinity-rotation
+ *
+ * The three reversals are fused into a single pass from both ends, so that every element is touched once.
+ *
+ * @param first
+ * @param middle
+ *   @pre first < middle
+ * @param last
+ *   @pre middle < last
+ */
+template <typename Iterator>
+SAYHISORT_CONSTEXPR_SWAP void RotateTrinity(Iterator first, Iterator middle, Iterator last) {
+    diff_t<Iterator> l_len = middle - first;
+    diff_t<Iterator> r_len = last - middle;
+
+    if (l_len == r_len) {
+        SwapRanges(first, middle, l_len);
+        return;
+    }
+
+    // Reverse [first, middle) and [middle, last) while moving elements to the other end, until the shorter one is done
+    Iterator l_last = middle;
+    for (diff_t<Iterator> i = std::min(l_len, r_len) / 2; i > 0; --i) {
+        --l_last;
+        --last;
+        RotateValues(first, middle, last, l_last);
+        ++first;
+        ++middle;
+    }
+
+    // Continue reversing the longer one, while moving elements to the other end
+    if (l_len < r_len) {
+        for (diff_t<Iterator> i = (last - middle) / 2; i > 0; --i) {
+            --last;
+            RotateValues(first, middle, last);
+            ++first;
+            ++middle;
+        }
+    } else {
+        for (diff_t<Iterator> i = (l_last - first) / 2; i > 0; --i) {
+            --l_last;
+            --last;
+            RotateValues(first, last, l_last);
+            ++first;
+        }
+    }
+
+    // Reverse the rest
+    while (last - first > 1) {
+        swap(*first++, *--last);
+    }
+}
+
+//! Maximum size of the shorter chunk to be rotated through a stack buffer
+constexpr std::size_t kRotateBufBytes = 512;
+
+/**
+ * @brief Rotate two chunks split at `middle`, by copying the shorter one through a stack buffer
+ *
+ * @param first
+ * @param middle
+ *   @pre first < middle
+ * @param last
+ *   @pre middle < last
+ *   @pre min(middle - first, last - middle) * sizeof(T) <= kRotateBufBytes
+ */
+template <typename T>
+void RotateWithStackBuf(T* first, T* middle, T* last) {
+    std::size_t l_len = static_cast<std::size_t>(middle - first);
+    std::size_t r_len = static_cast<std::size_t>(last - middle);
+
+    alignas(T) unsigned char tmp[kRotateBufBytes];
+    if (l_len <= r_len) {
+        std::memcpy(tmp, first, l_len * sizeof(T));
+        std::memmove(first, middle, r_len * sizeof(T));
+        std::memcpy(first + r_len, tmp, l_len * sizeof(T));
+    } else {
+        std::memcpy(tmp, middle, r_len * sizeof(T));
+        std::memmove(first + r_len, first, l_len * sizeof(T));
+        std::memcpy(first, tmp, r_len * sizeof(T));
+    }
+}
+
+//! Below this length of the shorter chunk, helix rotation degrades to chains of dependent swaps
+constexpr std::ptrdiff_t kMinHelixLen = 8;
+
 /**
  * @brief Rotate two chunks split at `middle`
  *
+ * It's basically the helix rotation, but once the shorter chunk gets short, it's finished by another algorithm.
+ * Trivially copyable elements in contiguous storage are rotated through a stack buffer, and others are rotated by the
+ * trinity rotation.
+ *
  * @param first
  * @param middle
  *   @pre first <= middle
@@ -68,6 +474,11 @@ template <typename Iterator>
 SAYHISORT_CONSTEXPR_SWAP void Rotate(Iterator first, Iterator middle, Iterator last) {
     // Helix Rotation
     // description available: https://github.com/scandum/rotate#helix-rotation
+    using T = std::remove_cv_t<typename std::iterator_traits<Iterator>::value_type>;
+    if constexpr (IsZipIterator<Iterator>::value) {
+        // Every column is rotated the same, and one by one it benefits from the fast paths for its type
+        return ForEachColumn([](auto f, auto m, auto l) { Rotate(f, m, l); }, first, middle, last);
+    }
     diff_t<Iterator> l_len = middle - first;
     diff_t<Iterator> r_len = last - middle;
 
@@ -76,11 +487,22 @@ SAYHISORT_CONSTEXPR_SWAP void Rotate(Iterator first, Iterator middle, Iterator l
     }
 
     while (true) {
+        diff_t<Iterator> min_len = std::min(l_len, r_len);
+        if constexpr (std::is_trivially_copyable_v<T> && kIsContiguousIterator<Iterator>) {
+            if (!IsConstantEvaluated() && static_cast<std::size_t>(min_len) <= kRotateBufBytes / sizeof(T)) {
+                T* p = std::addressof(*first);
+                return RotateWithStackBuf(p, p + l_len, p + (l_len + r_len));
+            }
+        }
+        if (min_len < kMinHelixLen) {
+            return RotateTrinity(first, middle, last);
+        }
+
         if (l_len <= r_len) {
             diff_t<Iterator> rem = r_len % l_len;
-            do {
-                swap(*first++, *middle++);
-            } while (--r_len);
+            SwapRanges(first, middle, r_len);
+            first += r_len;
+            middle += r_len;
             if (!rem) {
                 return;
             }
@@ -90,9 +512,9 @@ SAYHISORT_CONSTEXPR_SWAP void Rotate(Iterator first, Iterator middle, Iterator l
             r_len = rem;
         } else {
             diff_t<Iterator> rem = l_len % r_len;
-            do {
-                swap(*--last, *--middle);
-            } while (--l_len);
+            SwapRangesBackward(last, middle, l_len);
+            last -= l_len;
+            middle -= l_len;
             if (!rem) {
                 return;
             }
@@ -105,1049 +527,4040 @@ SAYHISORT_CONSTEXPR_SWAP void Rotate(Iterator first, Iterator middle, Iterator l
 }
 
 /**
- * @brief Search key from sorted sequence.
+ * @brief Whether comparing values of type `T` by `Compare` is as cheap as a single instruction.
  *
- * @param first
- *   @pre first < last
- * @param last
- * @return pos
- *   @post If nonstrict=false: for any x in [first, last),  comp(*x, *key) iff x < pos
- *   @post If nonstrict=true:  for any x in [first, last), !comp(*key, *x) iff x < pos
+ * If so, branchless code is preferred, since branch mispredictions cost more than the comparison itself.
  */
-template <bool nonstrict, typename Iterator, typename Compare>
-constexpr Iterator BinarySearch(Iterator first, Iterator last, Iterator key, Compare comp) {
-    // So-called monobound binary search
-    // The algorithm statically determines how many times the loop body runs, so that CPU pipeline becomes happier
-    // See https://github.com/scandum/binary_search for idea
-    auto pred = [&comp, &key](Iterator p) {
-        if constexpr (nonstrict) {
-            return !comp(*key, *p);
-        } else {
-            return comp(*p, *key);
-        }
-    };
+template <typename Compare, typename T>
+struct IsCheapCompare : std::false_type {};
 
-    Iterator base = first;
-    diff_t<Iterator> len = last - first;
-    diff_t<Iterator> mid{};
+template <typename T>
+struct IsCheapCompare<std::less<T>, T> : std::is_arithmetic<T> {};
 
-    while ((mid = len / 2)) {
-        Iterator pivot = base + mid;
-        if (pred(pivot)) {
-            base = pivot;
-        }
-        len -= mid;
-    }
+template <typename T>
+struct IsCheapCompare<std::less<>, T> : std::is_arithmetic<T> {};
 
-    base += pred(base);
-    return base;
-}
+template <typename T>
+struct IsCheapCompare<std::greater<T>, T> : std::is_arithmetic<T> {};
+
+template <typename T>
+struct IsCheapCompare<std::greater<>, T> : std::is_arithmetic<T> {};
+
+#if __cpp_lib_ranges >= 201911L
+template <typename T>
+struct IsCheapCompare<std::ranges::less, T> : std::is_arithmetic<T> {};
+
+template <typename T>
+struct IsCheapCompare<std::ranges::greater, T> : std::is_arithmetic<T> {};
+#endif
+
+template <typename Iterator, typename Compare>
+constexpr bool kIsCheapCompare =
+    IsCheapCompare<Compare, std::remove_cv_t<typename std::iterator_traits<Iterator>::value_type>>::value;
+
+//! Whether `Compare` is a transparent function object applying the builtin `<`
+template <typename Compare>
+constexpr bool kIsLess = std::is_same_v<Compare, std::less<>>
+#if __cpp_lib_ranges >= 201911L
+                         || std::is_same_v<Compare, std::ranges::less>
+#endif
+    ;
+
+//! Whether `Compare` is a transparent function object applying the builtin `>`
+template <typename Compare>
+constexpr bool kIsGreater = std::is_same_v<Compare, std::greater<>>
+#if __cpp_lib_ranges >= 201911L
+                            || std::is_same_v<Compare, std::ranges::greater>
+#endif
+    ;
+
+/**
+ * @brief Whether the sort order by `Compare` is ascending (1), descending (-1), or unknown (0) in terms of builtin
+ * comparison operators.
+ */
+template <typename Compare, typename T>
+constexpr int kBuiltinOrder = std::is_same_v<Compare, std::less<T>> || kIsLess<Compare>         ? 1
+                              : std::is_same_v<Compare, std::greater<T>> || kIsGreater<Compare> ? -1
+                                                                                                : 0;
 
 //
-// Basic merge routines
+// SIMD searching
 //
 
-template <typename Iterator>
-struct MergeResult {
-    bool xs_consumed;
-    Iterator rest;
+/**
+ * @brief Instruction sets of SIMD kernels, ordered from the least capable.
+ */
+enum class SimdIsa {
+    kNone,
+    kSse41,
+    kAvx2,
+    kAvx512,
 };
 
 /**
- * @brief Merge adjacent sequences xs and ys into the buffer before xs. The buffer moves while merging.
- *
- * When xs or ys becomes empty, the function returns which of xs or ys is fully consumed, as well as
- * the iterator to the rest data.
- *
- * The sequence ys cannot be longer the the length of the buffer (because buffer overrun isn't checked.)
- *
- * @param buf
- *   @pre buf < xs. We let buf_len = xs - buf.
- *   @post rest - buf = buf_len.
- * @param xs
- *   @pre xs < ys
- * @param ys
- *   @pre ys < ys_last
- *   @pre ys_last - ys <= buf_len
- * @param ys_last
- * @param comp
- * @return xs_consumed: Whether `rest` contains elements from `ys`.
- * @return rest: Elements not merged.
- *   @post xs < rest < ys_last
- *
- * @note The implementation actually works if xs or ys is empty, but the behaviour shall not be depended on.
+ * @brief The most capable instruction set supported by the CPU, which is detected at the first call if dispatched at
+ * run time.
  */
-template <bool flipped, typename Iterator, typename Compare>
-SAYHISORT_CONSTEXPR_SWAP MergeResult<Iterator> MergeWithBuf(Iterator& buf, Iterator xs, Iterator ys, Iterator ys_last,
-                                                            Compare comp) {
-    // So-called cross merge optimization is applied
-    // See https://github.com/scandum/quadsort#cross-merge for idea
-    auto is_x_selected = [&comp](decltype(xs[0]) x, decltype(ys[0]) y) {
-        if constexpr (flipped) {
-            return comp(x, y);
-        } else {
-            return !comp(y, x);
+inline SimdIsa CpuSimdIsa() {
+#if SAYHISORT_RUNTIME_DISPATCH
+    static const SimdIsa isa = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return SimdIsa::kAvx512;
         }
-    };
+        if (__builtin_cpu_supports("avx2")) {
+            return SimdIsa::kAvx2;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            return SimdIsa::kSse41;
+        }
+        return SimdIsa::kNone;
+    }();
+    return isa;
+#elif defined(__AVX512F__)
+    return SimdIsa::kAvx512;
+#elif defined(__AVX2__)
+    return SimdIsa::kAvx2;
+#elif defined(__SSE4_1__)
+    return SimdIsa::kSse41;
+#else
+    return SimdIsa::kNone;
+#endif
+}
 
-    Iterator xs_last = ys;
+#if SAYHISORT_HAS_SIMD_LEAVES
 
-#if 0
-    while (xs < xs_last && ys < ys_last) {
-        if (is_x_selected(xs[0], ys[0])) {
-            swap(*buf++, *xs++);
-        } else {
-            swap(*buf++, *ys++);
-        }
-    }
-    bool xs_consumed = xs == xs_last;
+inline int PopCount(unsigned x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(x);
 #else
-    while (xs < xs_last - 1 && ys < ys_last - 1) {
-        if (is_x_selected(xs[1], ys[0])) {
-            swap(*buf++, *xs++);
-            swap(*buf++, *xs++);
-        } else if (!is_x_selected(xs[0], ys[1])) {
-            swap(*buf++, *ys++);
-            swap(*buf++, *ys++);
-        } else {
-            bool y_pos = is_x_selected(xs[0], ys[0]);
-            swap(buf[!y_pos], *xs++);
-            swap(buf[y_pos], *ys++);
-            buf += 2;
+    return static_cast<int>(__popcnt(x));
+#endif
+}
+
+#endif
+
+/**
+ * @brief SIMD comparison of a key with consecutive elements, specialized for each instruction set and element type.
+ *
+ * A specialization provides the following members, all of which are compiled for the instruction set:
+ *   - `kLanes`: number of elements compared at once
+ *   - `CountLess(p, key)`, `CountGreater(p, key)`: number of elements in `[p, p + kLanes)` less or greater than `key`
+ */
+template <SimdIsa isa, typename T, std::size_t = sizeof(T)>
+struct SimdSearchOps {
+    static constexpr bool kAvailable = false;
+};
+
+#if SAYHISORT_RUNTIME_DISPATCH || defined(__AVX512F__)
+
+template <typename T>
+struct SimdSearchOps<SimdIsa::kAvx512, T, 4> {
+    static constexpr bool kAvailable = true;
+    static constexpr int kLanes = 16;
+
+    SAYHISORT_TARGET("avx512f,popcnt") static int CountLess(const T* p, T key) {
+        __m512i v = _mm512_loadu_si512(p);
+        __m512i k = _mm512_set1_epi32(static_cast<int>(key));
+        if constexpr (std::is_signed_v<T>) {
+            return PopCount(_mm512_cmplt_epi32_mask(v, k));
+        } else {
+            return PopCount(_mm512_cmplt_epu32_mask(v, k));
+        }
+    }
+
+    SAYHISORT_TARGET("avx512f,popcnt") static int CountGreater(const T* p, T key) {
+        __m512i v = _mm512_loadu_si512(p);
+        __m512i k = _mm512_set1_epi32(static_cast<int>(key));
+        if constexpr (std::is_signed_v<T>) {
+            return PopCount(_mm512_cmpgt_epi32_mask(v, k));
+        } else {
+            return PopCount(_mm512_cmpgt_epu32_mask(v, k));
         }
     }
+};
 
-    bool xs_consumed = xs == xs_last;
+template <typename T>
+struct SimdSearchOps<SimdIsa::kAvx512, T, 8> {
+    static constexpr bool kAvailable = true;
+    static constexpr int kLanes = 8;
 
-    if (xs == xs_last - 1) {
-        xs_consumed = false;
-        do {
-            if (is_x_selected(xs[0], ys[0])) {
-                swap(*buf++, *xs++);
-                xs_consumed = true;
-                break;
-            }
-            swap(*buf++, *ys++);
-        } while (ys < ys_last);
+    SAYHISORT_TARGET("avx512f,popcnt") static int CountLess(const T* p, T key) {
+        __m512i v = _mm512_loadu_si512(p);
+        __m512i k = _mm512_set1_epi64(static_cast<long long>(key));
+        if constexpr (std::is_signed_v<T>) {
+            return PopCount(_mm512_cmplt_epi64_mask(v, k));
+        } else {
+            return PopCount(_mm512_cmplt_epu64_mask(v, k));
+        }
+    }
 
-    } else if (ys == ys_last - 1) {
-        xs_consumed = true;
-        do {
-            if (!is_x_selected(xs[0], ys[0])) {
-                swap(*buf++, *ys++);
-                xs_consumed = false;
-                break;
-            }
-            swap(*buf++, *xs++);
-        } while (xs < xs_last);
+    SAYHISORT_TARGET("avx512f,popcnt") static int CountGreater(const T* p, T key) {
+        __m512i v = _mm512_loadu_si512(p);
+        __m512i k = _mm512_set1_epi64(static_cast<long long>(key));
+        if constexpr (std::is_signed_v<T>) {
+            return PopCount(_mm512_cmpgt_epi64_mask(v, k));
+        } else {
+            return PopCount(_mm512_cmpgt_epu64_mask(v, k));
+        }
     }
+};
+
 #endif
 
-    // Case: xs == xs_last
-    //    [ merged | buffer | buffer | right ]
-    //            buf       xs       ys    ys_last
-    if (xs_consumed) {
-        return {true, ys};
+#if SAYHISORT_RUNTIME_DISPATCH || defined(__AVX2__)
+
+// AVX2 lacks unsigned comparison, so sign bits are flipped for unsigned types
+template <typename T>
+struct SimdSearchOps<SimdIsa::kAvx2, T, 4> {
+    static constexpr bool kAvailable = true;
+    static constexpr int kLanes = 8;
+
+    SAYHISORT_TARGET("avx2,popcnt") static int CountLess(const T* p, T key) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i k = _mm256_set1_epi32(static_cast<int>(key));
+        if constexpr (std::is_unsigned_v<T>) {
+            __m256i sign = _mm256_set1_epi32(std::numeric_limits<int>::min());
+            v = _mm256_xor_si256(v, sign);
+            k = _mm256_xor_si256(k, sign);
+        }
+        return PopCount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, v)))));
     }
 
-    // Case: ys == ys_last
-    //    [ merged | buffer | left  | buffer ]
-    //            buf       xs   xs_last     ys
-    // -> After repeatedly applying swaps:
-    //    [ merged | buffer | buffer | left  ]
-    //            buf       xs       ys    ys_last
-    do {
-        swap(*--ys, *--xs_last);
-    } while (xs_last != xs);
-    return {false, ys};
+    SAYHISORT_TARGET("avx2,popcnt") static int CountGreater(const T* p, T key) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i k = _mm256_set1_epi32(static_cast<int>(key));
+        if constexpr (std::is_unsigned_v<T>) {
+            __m256i sign = _mm256_set1_epi32(std::numeric_limits<int>::min());
+            v = _mm256_xor_si256(v, sign);
+            k = _mm256_xor_si256(k, sign);
+        }
+        return PopCount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, k)))));
+    }
+};
+
+template <typename T>
+struct SimdSearchOps<SimdIsa::kAvx2, T, 8> {
+    static constexpr bool kAvailable = true;
+    static constexpr int kLanes = 4;
+
+    SAYHISORT_TARGET("avx2,popcnt") static int CountLess(const T* p, T key) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i k = _mm256_set1_epi64x(static_cast<long long>(key));
+        if constexpr (std::is_unsigned_v<T>) {
+            __m256i sign = _mm256_set1_epi64x(std::numeric_limits<long long>::min());
+            v = _mm256_xor_si256(v, sign);
+            k = _mm256_xor_si256(k, sign);
+        }
+        return PopCount(static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(k, v)))));
+    }
+
+    SAYHISORT_TARGET("avx2,popcnt") static int CountGreater(const T* p, T key) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i k = _mm256_set1_epi64x(static_cast<long long>(key));
+        if constexpr (std::is_unsigned_v<T>) {
+            __m256i sign = _mm256_set1_epi64x(std::numeric_limits<long long>::min());
+            v = _mm256_xor_si256(v, sign);
+            k = _mm256_xor_si256(k, sign);
+        }
+        return PopCount(static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, k)))));
+    }
+};
+
+#endif
+
+#if SAYHISORT_RUNTIME_DISPATCH || defined(__SSE4_1__)
+
+template <typename T>
+struct SimdSearchOps<SimdIsa::kSse41, T, 4> {
+    static constexpr bool kAvailable = true;
+    static constexpr int kLanes = 4;
+
+    SAYHISORT_TARGET("sse4.1") static int CountLess(const T* p, T key) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i k = _mm_set1_epi32(static_cast<int>(key));
+        if constexpr (std::is_unsigned_v<T>) {
+            __m128i sign = _mm_set1_epi32(std::numeric_limits<int>::min());
+            v = _mm_xor_si128(v, sign);
+            k = _mm_xor_si128(k, sign);
+        }
+        return PopCount(static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(k, v)))));
+    }
+
+    SAYHISORT_TARGET("sse4.1") static int CountGreater(const T* p, T key) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i k = _mm_set1_epi32(static_cast<int>(key));
+        if constexpr (std::is_unsigned_v<T>) {
+            __m128i sign = _mm_set1_epi32(std::numeric_limits<int>::min());
+            v = _mm_xor_si128(v, sign);
+            k = _mm_xor_si128(k, sign);
+        }
+        return PopCount(static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, k)))));
+    }
+};
+
+#endif
+
+/**
+ * @brief Number of elements in `[p, p + kLanes)` satisfying the predicate of `BinarySearch`.
+ */
+template <typename Ops, bool nonstrict, bool descending, typename T>
+inline int CountPred(const T* p, T key) {
+    if constexpr (descending) {
+        return nonstrict ? Ops::kLanes - Ops::CountLess(p, key) : Ops::CountGreater(p, key);
+    } else {
+        return nonstrict ? Ops::kLanes - Ops::CountGreater(p, key) : Ops::CountLess(p, key);
+    }
 }
 
 /**
- * @brief Merge sequences xs and ys in-place.
+ * @brief `BinarySearch` whose last steps are replaced by a SIMD comparison with `kLanes` elements.
  *
- * When xs or ys becomes empty, the function returns which of xs or ys is fully consumed, as well as
- * the iterator to the rest data.
+ * The monobound search leaves a window of at most `kLanes` elements, which contains the position. The window is
+ * widened to exactly `kLanes` elements, moving it back if it would run over the end; elements moved into the window
+ * from the front satisfy the predicate, and ones from the back don't. So the position is found by counting.
  *
- * @param xs
- *   @pre xs < ys
- * @param ys
- *   @pre ys < ys_last
- *   @post ys < ys_last
- * @param ys_last
+ * @param first
+ * @param len
+ *   @pre len >= Ops::kLanes
+ * @param key
  * @param comp
- * @note For better performance, `xs` should be not much longer than `ys`.
- *       The time complexity is `O((m + log(n)) * min(m, n, j, k) + m + n)`, where
- *       `m` and `n` are the lengthes of `xs` and `ys`, whereas `j` and `k` are
- *       the numbers of unique keys in `xs` and `ys`.
+ * @return pos - first
  */
-template <bool flipped, typename Iterator, typename Compare>
-SAYHISORT_CONSTEXPR_SWAP MergeResult<Iterator> MergeWithoutBuf(Iterator xs, Iterator ys, Iterator ys_last,
-                                                               Compare comp) {
-    while (true) {
-        // Seek xs so that xs[0] > ys[0]
-        xs = BinarySearch<!flipped>(xs, ys, ys, comp);
-        if (xs == ys) return {true, ys};
-        // Insert xs to ys
-        Iterator ys_upper = ys + 1;
-        if (ys_upper != ys_last) {
-            ys_upper = BinarySearch<flipped>(ys_upper, ys_last, xs, comp);
-        }
-        Rotate(xs, ys, ys_upper);
-        xs += ys_upper - ys;
-        ys = ys_upper;
-        if (ys_upper == ys_last) {
-            return {false, xs};
+template <typename Ops, bool nonstrict, typename T, typename SsizeT, typename Compare>
+SsizeT SimdSearch(const T* first, SsizeT len, T key, Compare comp) {
+    constexpr bool descending = kBuiltinOrder<Compare, T> < 0;
+    SsizeT base = 0;
+    SsizeT rest = len;
+    while (rest > Ops::kLanes) {
+        SsizeT mid = rest / 2;
+        if (nonstrict ? !comp(key, first[base + mid]) : comp(first[base + mid], key)) {
+            base += mid;
         }
+        rest -= mid;
     }
+    base = base < len - Ops::kLanes ? base : len - Ops::kLanes;
+    return base + CountPred<Ops, nonstrict, descending>(first + base, key);
 }
 
-//
-// Block merge subroutines
-//
+//! Number of probes searched in lockstep by `SimdSearchBatch`
+constexpr int kSearchBatchLen = 8;
 
 /**
- * @brief Interleave blocks from two sorted sequences, so that blocks are sorted by their first elements.
+ * @brief `SimdSearch` for many probes, `kSearchBatchLen` probes in lockstep.
  *
- * @param imit
- * @param blocks
- *   @pre [imit, imit + num_blocks) and [blocks, bloks + num_blocks * block_len) are non-overlapping
- * @param num_blocks
- *   @pre num_blocks is non-negative
- * @param block_len
- *   @pre block_len is positive
+ * The monobound search takes the same steps for any probe, so steps for the batch are interleaved, which hides the
+ * latency of loads and comparisons of each search behind the others.
+ *
+ * @param first
+ * @param len
+ *   @pre len >= Ops::kLanes
+ * @param probes
+ * @param num_probes
+ * @param out Receives `pos - first` for each probe.
  * @param comp
  */
-template <typename Iterator, typename Compare>
-SAYHISORT_CONSTEXPR_SWAP Iterator InterleaveBlocks(Iterator imit, Iterator blocks, diff_t<Iterator> num_blocks,
-                                                   diff_t<Iterator> block_len, Compare comp) {
-    // Algorithm similar to wikisort's block movement
-    // https://github.com/BonzaiThePenguin/WikiSort/blob/master/Chapter%203.%20In-Place.md
-    //
-    // While interleaving, the state of blocks is like:
-    //   [interleaved | left_permuted | right]
-    // We pick the least block `least_left` from `left_permuted` by linear search.
-    // Then we compare `least_left` with `right[0]`, and swap the selected block for
-    // `left_permuted[0]`.
-    auto swapBlock = [block_len](Iterator a, Iterator b) {
-        if (a == b) {
-            return;
+template <typename Ops, bool nonstrict, typename T, typename SsizeT, typename Index, typename Compare>
+void SimdSearchBatch(const T* first, SsizeT len, const T* probes, SsizeT num_probes, Index* out, Compare comp) {
+    constexpr bool descending = kBuiltinOrder<Compare, T> < 0;
+    SsizeT i = 0;
+    for (; i + kSearchBatchLen <= num_probes; i += kSearchBatchLen) {
+        SsizeT bases[kSearchBatchLen]{};
+        SsizeT rest = len;
+        while (rest > Ops::kLanes) {
+            SsizeT mid = rest / 2;
+            for (int j = 0; j < kSearchBatchLen; ++j) {
+                const T& x = first[bases[j] + mid];
+                bases[j] += (nonstrict ? !comp(probes[i + j], x) : comp(x, probes[i + j])) ? mid : 0;
+            }
+            rest -= mid;
         }
-        diff_t<Iterator> i = block_len;
-        do {
-            swap(*a++, *b++);
-        } while (--i);
-    };
+        for (int j = 0; j < kSearchBatchLen; ++j) {
+            SsizeT base = bases[j] < len - Ops::kLanes ? bases[j] : len - Ops::kLanes;
+            out[i + j] = static_cast<Index>(base + CountPred<Ops, nonstrict, descending>(first + base, probes[i + j]));
+        }
+    }
+    for (; i < num_probes; ++i) {
+        out[i] = static_cast<Index>(SimdSearch<Ops, nonstrict>(first, len, probes[i], comp));
+    }
+}
 
-    Iterator left_keys = imit;
-    Iterator right_keys = imit + num_blocks / 2;
-    Iterator left_blocks = blocks;
-    Iterator right_blocks = left_blocks + num_blocks / 2 * block_len;
+/**
+ * @brief Entry points of SIMD searches compiled for each instruction set, into which the whole search is inlined.
+ */
+template <SimdIsa isa>
+struct SimdSearchKernel;
 
-    Iterator least_left_key = left_keys;
-    Iterator least_left_block = left_blocks;
+template <>
+struct SimdSearchKernel<SimdIsa::kSse41> {
+    template <bool nonstrict, typename T, typename SsizeT, typename Compare>
+    SAYHISORT_TARGET("sse4.1") SAYHISORT_FLATTEN static SsizeT Search(const T* first, SsizeT len, T key,
+                                                                      Compare comp) {
+        return SimdSearch<SimdSearchOps<SimdIsa::kSse41, T>, nonstrict>(first, len, key, comp);
+    }
 
-    Iterator least_right_key = right_keys;
-    Iterator last_right_key = right_keys + num_blocks / 2;
+    template <bool nonstrict, typename T, typename SsizeT, typename Index, typename Compare>
+    SAYHISORT_TARGET("sse4.1") SAYHISORT_FLATTEN static void SearchBatch(const T* first, SsizeT len,
+                                                                         const T* probes, SsizeT num_probes,
+                                                                         Index* out, Compare comp) {
+        SimdSearchBatch<SimdSearchOps<SimdIsa::kSse41, T>, nonstrict>(first, len, probes, num_probes, out, comp);
+    }
+};
 
-    while (left_keys < right_keys) {
-        if (right_keys == last_right_key || !comp(*right_blocks, *least_left_block)) {
-            swap(*left_keys, *least_left_key);
-            swapBlock(left_blocks, least_left_block);
+template <>
+struct SimdSearchKernel<SimdIsa::kAvx2> {
+    template <bool nonstrict, typename T, typename SsizeT, typename Compare>
+    SAYHISORT_TARGET("avx2,popcnt") SAYHISORT_FLATTEN static SsizeT Search(const T* first, SsizeT len, T key,
+                                                                           Compare comp) {
+        return SimdSearch<SimdSearchOps<SimdIsa::kAvx2, T>, nonstrict>(first, len, key, comp);
+    }
 
-            ++left_keys;
-            left_blocks += block_len;
+    template <bool nonstrict, typename T, typename SsizeT, typename Index, typename Compare>
+    SAYHISORT_TARGET("avx2,popcnt") SAYHISORT_FLATTEN static void SearchBatch(const T* first, SsizeT len,
+                                                                              const T* probes, SsizeT num_probes,
+                                                                              Index* out, Compare comp) {
+        SimdSearchBatch<SimdSearchOps<SimdIsa::kAvx2, T>, nonstrict>(first, len, probes, num_probes, out, comp);
+    }
+};
 
-            least_left_key = left_keys;
-            least_left_block = left_blocks;
-            if (right_keys != least_right_key) {  // skip searching if left keys aren't permuted
-                for (Iterator key = left_keys + 1; key < right_keys; ++key) {
-                    if (comp(*key, *least_left_key)) {
-                        least_left_key = key;
-                    }
-                }
-                least_left_block = left_blocks + (least_left_key - left_keys) * block_len;
-            }
+template <>
+struct SimdSearchKernel<SimdIsa::kAvx512> {
+    template <bool nonstrict, typename T, typename SsizeT, typename Compare>
+    SAYHISORT_TARGET("avx512f,popcnt") SAYHISORT_FLATTEN static SsizeT Search(const T* first, SsizeT len, T key,
+                                                                              Compare comp) {
+        return SimdSearch<SimdSearchOps<SimdIsa::kAvx512, T>, nonstrict>(first, len, key, comp);
+    }
 
-        } else {
-            swap(*left_keys, *right_keys);
-            swapBlock(left_blocks, right_blocks);
+    template <bool nonstrict, typename T, typename SsizeT, typename Index, typename Compare>
+    SAYHISORT_TARGET("avx512f,popcnt") SAYHISORT_FLATTEN static void SearchBatch(const T* first, SsizeT len,
+                                                                                 const T* probes, SsizeT num_probes,
+                                                                                 Index* out, Compare comp) {
+        SimdSearchBatch<SimdSearchOps<SimdIsa::kAvx512, T>, nonstrict>(first, len, probes, num_probes, out, comp);
+    }
+};
 
-            if (left_keys == least_left_key) {
-                least_left_key = right_keys;
-                least_left_block = right_blocks;
-            }
-            if (right_keys == least_right_key) {
-                least_right_key = left_keys;
-            }
-            ++left_keys;
-            ++right_keys;
-            left_blocks += block_len;
-            right_blocks += block_len;
-        }
+/**
+ * @brief The most capable instruction set which has SIMD searches of `T` and is supported by the CPU.
+ */
+template <typename T>
+SimdIsa SimdSearchIsa() {
+    SimdIsa cpu = CpuSimdIsa();
+    if (SimdSearchOps<SimdIsa::kAvx512, T>::kAvailable && cpu >= SimdIsa::kAvx512) {
+        return SimdIsa::kAvx512;
+    }
+    if (SimdSearchOps<SimdIsa::kAvx2, T>::kAvailable && cpu >= SimdIsa::kAvx2) {
+        return SimdIsa::kAvx2;
+    }
+    if (SimdSearchOps<SimdIsa::kSse41, T>::kAvailable && cpu >= SimdIsa::kSse41) {
+        return SimdIsa::kSse41;
     }
+    return SimdIsa::kNone;
+}
 
-    return least_right_key;
+/**
+ * @brief Whether sorted sequences may be searched by SIMD comparisons, if the CPU supports an instruction set for them.
+ */
+template <typename Iterator, typename Compare,
+          typename T = std::remove_cv_t<typename std::iterator_traits<Iterator>::value_type>>
+constexpr bool kHasSimdSearch =
+    std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+    (SimdSearchOps<SimdIsa::kSse41, T>::kAvailable || SimdSearchOps<SimdIsa::kAvx2, T>::kAvailable ||
+     SimdSearchOps<SimdIsa::kAvx512, T>::kAvailable) &&
+    kBuiltinOrder<Compare, T> != 0 && kIsContiguousIterator<Iterator>;
+
+template <SimdIsa isa, bool nonstrict, typename T, typename SsizeT, typename Compare>
+SsizeT SimdSearchFor(const T* first, SsizeT len, T key, Compare comp) {
+    if constexpr (SimdSearchOps<isa, T>::kAvailable) {
+        if (len >= SimdSearchOps<isa, T>::kLanes) {
+            return SimdSearchKernel<isa>::template Search<nonstrict>(first, len, key, comp);
+        }
+    }
+    return -1;
 }
 
 /**
- * @brief Sort interleaved keys in imitation buffer, using another auxiliary buffer.
+ * @brief `SimdSearch` for the CPU.
  *
- * @param imit
- * @param imit_len
- *   @pre imit_len is a positive multiple of 2
- * @param buf
- *   @pre [imit, imit + imit_len) and [buf, buf + imit_len / 2) are non-overlapping
- * @param mid_key
- * @param comp
+ * @return pos - first; or -1 if the CPU supports no instruction set for it, or len is shorter than its lanes
  */
-template <typename Iterator, typename Compare>
-SAYHISORT_CONSTEXPR_SWAP void DeinterleaveImitation(Iterator imit, diff_t<Iterator> imit_len, Iterator buf,
-                                                    Iterator mid_key, Compare comp) {
-    // Bin-sort like algorithm based on partitioning.
-    // Same algorithm founds in HolyGrailsort.
-    // https://github.com/HolyGrailSortProject/Holy-Grailsort/blob/ccfcc4315c6ccafbca5f6a51886710898a06c8a1/Holy%20Grail%20Sort/Java/Summer%20Dragonfly%20et%20al.'s%20Rough%20Draft/src/holygrail/HolyGrailSort.java#L1328-L1330
-    swap(*mid_key, *buf);
-    Iterator left_cur = mid_key;
-    Iterator right_cur = buf + 1;
-    Iterator cur = mid_key + 1;
-    mid_key = buf;
+template <bool nonstrict, typename T, typename SsizeT, typename Compare>
+SsizeT DispatchSimdSearch(const T* first, SsizeT len, T key, Compare comp) {
+    switch (SimdSearchIsa<T>()) {
+        case SimdIsa::kAvx512:
+            return SimdSearchFor<SimdIsa::kAvx512, nonstrict>(first, len, key, comp);
+        case SimdIsa::kAvx2:
+            return SimdSearchFor<SimdIsa::kAvx2, nonstrict>(first, len, key, comp);
+        case SimdIsa::kSse41:
+            return SimdSearchFor<SimdIsa::kSse41, nonstrict>(first, len, key, comp);
+        case SimdIsa::kNone:
+            break;
+    }
+    return -1;
+}
 
-    while (cur != imit + imit_len) {
-        if (comp(*cur, *mid_key)) {
-            swap(*left_cur++, *cur++);
-        } else {
-            swap(*right_cur++, *cur++);
+template <SimdIsa isa, bool nonstrict, typename T, typename SsizeT, typename Index, typename Compare>
+bool SimdSearchBatchFor(const T* first, SsizeT len, const T* probes, SsizeT num_probes, Index* out, Compare comp) {
+    if constexpr (SimdSearchOps<isa, T>::kAvailable) {
+        if (len >= SimdSearchOps<isa, T>::kLanes) {
+            SimdSearchKernel<isa>::template SearchBatch<nonstrict>(first, len, probes, num_probes, out, comp);
+            return true;
         }
     }
-
-    // Append right keys in `buf` to `left_cur`
-    do {
-        swap(*left_cur++, *buf++);
-    } while (buf != right_cur);
+    return false;
 }
 
 /**
- * @brief Sort interleaved keys in imitation buffer, in-place.
+ * @brief `SimdSearchBatch` for the CPU.
  *
- * @param imit
- * @param imit_len
- *   @pre imit_len is a positive multiple of 2
- * @param mid_key
- * @param comp
+ * @return Whether searched; false if the CPU supports no instruction set for it, or len is shorter than its lanes
  */
-template <typename Iterator, typename Compare>
-SAYHISORT_CONSTEXPR_SWAP void DeinterleaveImitation(Iterator imit, diff_t<Iterator> imit_len, Iterator mid_key,
-                                                    Compare comp) {
-    // We colour each key by whether they are from left or right.
-    // Then we can see the imitation buffer as a sequence of runs with alternating colour.
-    //
-    // In one iteration, the algorithm rotate every pair of (right, left)-runs.
-    // When no such a pair is found, all keys are properly sorted.
-    // Each iteration halves the number of pairs, So the alogirithm works in O(N log N), where
-    // N is size of `imit`.
-    //
-    // The idea to rotate pairs of runs of is borrowed from HolyGrailsort's algorithm.
-    // https://github.com/HolyGrailSortProject/Holy-Grailsort/blob/ccfcc4315c6ccafbca5f6a51886710898a06c8a1/Holy%20Grail%20Sort/Java/Summer%20Dragonfly%20et%20al.'s%20Rough%20Draft/src/holygrail/HolyGrailSort.java#L1373-L1376
-    diff_t<Iterator> runlengths[2] = {};
-    diff_t<Iterator>& l_runlength = runlengths[0];
-    diff_t<Iterator>& r_runlength = runlengths[1];
+template <bool nonstrict, typename T, typename SsizeT, typename Index, typename Compare>
+bool DispatchSimdSearchBatch(const T* first, SsizeT len, const T* probes, SsizeT num_probes, Index* out,
+                             Compare comp) {
+    switch (SimdSearchIsa<T>()) {
+        case SimdIsa::kAvx512:
+            return SimdSearchBatchFor<SimdIsa::kAvx512, nonstrict>(first, len, probes, num_probes, out, comp);
+        case SimdIsa::kAvx2:
+            return SimdSearchBatchFor<SimdIsa::kAvx2, nonstrict>(first, len, probes, num_probes, out, comp);
+        case SimdIsa::kSse41:
+            return SimdSearchBatchFor<SimdIsa::kSse41, nonstrict>(first, len, probes, num_probes, out, comp);
+        case SimdIsa::kNone:
+            break;
+    }
+    return false;
+}
 
-    bool rotated{};
-    auto rotate_runs = [&](Iterator cur) {
-        if (!r_runlength) {
-            l_runlength = 0;
-            return;
-        }
-        Iterator l_run = cur - l_runlength;
-        Iterator r_run = l_run - r_runlength;
-        Rotate(r_run, l_run, cur);
-        if (!rotated) {
-            mid_key = cur - r_runlength;
-        }
-        l_runlength = 0;
-        r_runlength = 0;
-        rotated = true;
-    };
-
-    do {
-        l_runlength = 0;
-        r_runlength = 0;
-        rotated = false;
+//
+// Searching
+//
 
-        bool was_left = false;
-        Iterator cur = imit;
-        do {
-            bool is_right = !comp(*cur, *mid_key);
-            if (was_left && is_right) {
-                rotate_runs(cur);
+/**
+ * @brief Search key from sorted sequence.
+ *
+ * Integers in contiguous memory compared by builtin operators are searched by SIMD comparisons for the last steps.
+ *
+ * @param first
+ *   @pre first < last
+ * @param last
+ * @return pos
+ *   @post If nonstrict=false: for any x in [first, last),  comp(*x, *key) iff x < pos
+ *   @post If nonstrict=true:  for any x in [first, last), !comp(*key, *x) iff x < pos
+ */
+template <bool nonstrict, typename Iterator, typename Compare>
+constexpr Iterator BinarySearch(Iterator first, Iterator last, Iterator key, Compare comp) {
+    // So-called monobound binary search
+    // The algorithm statically determines how many times the loop body runs, so that CPU pipeline becomes happier
+    // See https://github.com/scandum/binary_search for idea
+    if constexpr (kHasSimdSearch<Iterator, Compare>) {
+        if (!IsConstantEvaluated()) {
+            using T = std::remove_cv_t<typename std::iterator_traits<Iterator>::value_type>;
+            diff_t<Iterator> pos = DispatchSimdSearch<nonstrict>(std::addressof(*first), last - first, T{*key}, comp);
+            if (pos >= 0) {
+                return first + pos;
             }
-            ++runlengths[is_right];
-            was_left = !is_right;
-        } while (++cur != imit + imit_len);
+        }
+    }
 
-        if (was_left) {
-            rotate_runs(cur);
+    auto pred = [&comp, &key](Iterator p) {
+        if constexpr (nonstrict) {
+            return !comp(*key, *p);
+        } else {
+            return comp(*p, *key);
         }
-    } while (rotated);
-}
+    };
 
-//
-// Full block merge
-//
+    Iterator base = first;
+    diff_t<Iterator> len = last - first;
+    diff_t<Iterator> mid{};
 
-template <typename SsizeT>
-struct BlockingParam {
-    SsizeT num_blocks;
-    SsizeT block_len;
-    SsizeT first_block_len;
-    SsizeT last_block_len;
-};
+    while ((mid = len / 2)) {
+        Iterator pivot = base + mid;
+        if (pred(pivot)) {
+            base = pivot;
+        }
+        len -= mid;
+    }
 
-template <bool has_buf, typename Iterator, typename Compare>
-SAYHISORT_CONSTEXPR_SWAP void MergeAdjacentBlocks(Iterator imit, Iterator& buf, Iterator blocks,
-                                                  BlockingParam<diff_t<Iterator>> p, Iterator mid_key, Compare comp) {
-    diff_t<Iterator> num_remained_blocks = p.num_blocks;
+    base += pred(base);
+    return base;
+}
 
-    enum BlockOrigin {
-        kLeft,
-        kRight,
+/**
+ * @brief Search key from sorted sequence, probing from the beginning with exponentially growing steps.
+ *
+ * It takes O(log(pos - first)) comparisons, so it's faster than `BinarySearch` if `pos` is expected to be near the
+ * beginning.
+ *
+ * @param first
+ * @param last
+ *   @pre first <= last
+ * @return pos
+ *   Same as `BinarySearch`.
+ */
+template <bool nonstrict, typename Iterator, typename Compare>
+constexpr Iterator ExponentialSearch(Iterator first, Iterator last, Iterator key, Compare comp) {
+    auto pred = [&comp, &key](Iterator p) {
+        if constexpr (nonstrict) {
+            return !comp(*key, *p);
+        } else {
+            return comp(*p, *key);
+        }
     };
 
-    Iterator xs = blocks;
-    Iterator xs_latest_block = xs;
-    BlockOrigin xs_origin = kLeft;
-    --num_remained_blocks;
-
-    Iterator cur = xs + p.first_block_len;
-
-    do {
-        Iterator cur_last = cur + (--num_remained_blocks ? p.block_len : p.last_block_len);
-        BlockOrigin cur_origin = (num_remained_blocks && comp(*imit++, *mid_key)) ? kLeft : kRight;
+    // Find a range [lo, hi) containing pos, by probing first[0], first[2], first[6], first[14], ...
+    diff_t<Iterator> len = last - first;
+    diff_t<Iterator> lo = 0;
+    diff_t<Iterator> hi = 1;
+    while (hi <= len && pred(first + (hi - 1))) {
+        lo = hi;
+        hi = hi * 2 + 1;
+    }
+    hi = hi - 1 < len ? hi - 1 : len;
 
-        if (cur_origin == xs_origin) {
-            xs_latest_block = cur;
-            cur = cur_last;
-            continue;
-        }
+    if (lo == hi) {
+        return first + lo;
+    }
+    return BinarySearch<nonstrict>(first + lo, first + hi, key, comp);
+}
 
-        // Optimization to safely skip continuing blocks those have the same origin.
-        // In particular, it's crucial when `has_buf = false`. In this case, time complexity isn't assured
-        // without the optimization, due to implementation detail of `MergeWithoutBuf`.
-        if (xs != xs_latest_block) {
-            if constexpr (has_buf) {
-                if (num_remained_blocks) {
-                    do {
-                        swap(*buf++, *xs++);
-                    } while (xs != xs_latest_block);
-                }
-            } else {
-                if (num_remained_blocks) {
-                    xs = xs_latest_block;
-                } else if (cur - xs > p.last_block_len) {
-                    // Ensure that length of xs is at most block_len
-                    Rotate(xs, cur, cur_last);
-                    cur = xs + p.last_block_len;
-                    xs_origin = kRight;
-                }
-            }
+/**
+ * @brief Search key, which is one of `num_keys` sorted keys to be inserted, from sorted sequence by Hwang and Lin's
+ * probing.
+ *
+ * The sequence is probed from the beginning in strides of 2^t elements, where t = floor(log2(len / num_keys)), and
+ * then binary searched within the stride. If keys are spread evenly over the sequence, each one is found by about t + 2
+ * comparisons, which nearly meets the lower bound of merging.
+ *
+ * @param first
+ *   @pre first < last
+ * @param last
+ * @param num_keys
+ *   @pre num_keys > 0
+ * @return pos
+ *   Same as `BinarySearch`.
+ */
+template <bool nonstrict, typename Iterator, typename Compare>
+constexpr Iterator HwangLinSearch(Iterator first, Iterator last, Iterator key, diff_t<Iterator> num_keys,
+                                  Compare comp) {
+    auto pred = [&comp, &key](Iterator p) {
+        if constexpr (nonstrict) {
+            return !comp(*key, *p);
+        } else {
+            return comp(*p, *key);
         }
+    };
 
-        MergeResult mr = ([&]() {
-            if constexpr (has_buf) {
-                if (xs_origin == kLeft) {
-                    return MergeWithBuf<false>(buf, xs, cur, cur_last, comp);
-                } else {
-                    return MergeWithBuf<true>(buf, xs, cur, cur_last, comp);
-                }
-            } else {
-                if (xs_origin == kLeft) {
-                    return MergeWithoutBuf<false>(xs, cur, cur_last, comp);
-                } else {
-                    return MergeWithoutBuf<true>(xs, cur, cur_last, comp);
-                }
-            }
-        })();
-
-        xs = mr.rest;
-        xs_latest_block = xs;
-        xs_origin = static_cast<BlockOrigin>(static_cast<bool>(xs_origin) ^ mr.xs_consumed);
+    diff_t<Iterator> stride = 1;
+    while (stride * 2 <= (last - first) / num_keys) {
+        stride *= 2;
+    }
+    while (last - first > stride && pred(first + (stride - 1))) {
+        first += stride;
+    }
+    return BinarySearch<nonstrict>(first, last - first > stride ? first + stride : last, key, comp);
+}
 
-        cur = cur_last;
-    } while (num_remained_blocks);
+//! Search algorithms selectable by merge routines
+enum class SearchKind {
+    //! `BinarySearch`, whose cost doesn't depend on the position
+    kBinary,
+    //! `ExponentialSearch`, which is cheaper if the position is near the beginning
+    kExponential,
+    //! `HwangLinSearch` for the longer sequence, which is the cheapest if the other is much shorter
+    kHwangLin,
+};
 
-    if constexpr (has_buf) {
-        Rotate(buf, xs, cur);
-        buf += cur - xs;
+template <bool nonstrict, SearchKind kind, typename Iterator, typename Compare>
+constexpr Iterator Search(Iterator first, Iterator last, Iterator key, Compare comp) {
+    static_assert(kind != SearchKind::kHwangLin, "Hwang-Lin search requires the number of keys");
+    if constexpr (kind == SearchKind::kExponential) {
+        return ExponentialSearch<nonstrict>(first, last, key, comp);
+    } else {
+        return BinarySearch<nonstrict>(first, last, key, comp);
     }
 }
 
-template <bool has_buf, typename Iterator, typename Compare>
-SAYHISORT_CONSTEXPR_SWAP void MergeBlocking(Iterator imit, Iterator& buf, Iterator blocks,
-                                            BlockingParam<diff_t<Iterator>> p, Compare comp) {
-    // Skip interleaving the first block and the last one, those may have shorter length.
-    diff_t<Iterator> imit_len = p.num_blocks - 2;
-    Iterator mid_key = InterleaveBlocks(imit, blocks + p.first_block_len, imit_len, p.block_len, comp);
-
-    MergeAdjacentBlocks<has_buf>(imit, buf, blocks, p, mid_key, comp);
-    if (!imit_len) {
-        return;
+/**
+ * @brief Search each of probes from sorted sequence, as `BinarySearch` does.
+ *
+ * Integers in contiguous memory compared by builtin operators are searched by batches of SIMD searches.
+ *
+ * @param first
+ *   @pre first < last
+ * @param last
+ * @param probes
+ * @param num_probes
+ * @param out Receives `BinarySearch<nonstrict>(first, last, probes + i, comp) - first` as out[i].
+ * @param comp
+ */
+template <bool nonstrict, typename Iterator, typename Index, typename Compare>
+constexpr void BatchSearch(Iterator first, Iterator last, Iterator probes, diff_t<Iterator> num_probes, Index* out,
+                           Compare comp) {
+    if constexpr (kHasSimdSearch<Iterator, Compare>) {
+        if (!IsConstantEvaluated() && num_probes > 0 &&
+            DispatchSimdSearchBatch<nonstrict>(std::addressof(*first), last - first, std::addressof(*probes),
+                                               num_probes, out, comp)) {
+            return;
+        }
     }
 
-    if constexpr (has_buf) {
-        DeinterleaveImitation(imit, imit_len, buf, mid_key, comp);
-    } else {
-        DeinterleaveImitation(imit, imit_len, mid_key, comp);
+    for (diff_t<Iterator> i = 0; i < num_probes; ++i) {
+        out[i] = static_cast<Index>(BinarySearch<nonstrict>(first, last, probes + i, comp) - first);
     }
 }
 
+#if __cpp_lib_ranges >= 201911L
 //
-// Bottom-up merge sort logics
+// Projections
 //
 
-template <typename Compare, bool = std::is_empty_v<Compare> && !std::is_final_v<Compare>>
-struct ReverseCompare : Compare {
-    constexpr ReverseCompare(Compare comp) : Compare(comp) {}
+/**
+ * @brief Comparator of projected values.
+ */
+template <typename Compare, typename Proj>
+struct ProjectedCompare {
+    constexpr ProjectedCompare(Compare comp, Proj proj) : comp_{comp}, proj_{proj} {}
 
-    template <typename T>
-    constexpr bool operator()(T&& lhs, T&& rhs) {
-        return Compare::operator()(std::forward<T>(rhs), std::forward<T>(lhs));
+    template <typename T1, typename T2>
+    constexpr bool operator()(T1&& lhs, T2&& rhs) {
+        return std::invoke(comp_, std::invoke(proj_, std::forward<T1>(lhs)), std::invoke(proj_, std::forward<T2>(rhs)));
     }
+
+private:
+    Compare comp_;
+    Proj proj_;
 };
 
+// Projection by a data member costs nothing more than a load
+template <typename Compare, typename Proj, typename T>
+struct IsCheapCompare<ProjectedCompare<Compare, Proj>, T>
+    : std::conjunction<std::is_member_object_pointer<Proj>,
+                       IsCheapCompare<Compare, std::remove_cvref_t<std::invoke_result_t<Proj&, T&>>>> {};
+#endif
+
+//
+// Statistics
+//
+
+/**
+ * @brief Comparator counting its calls into `sort_stats`, which also carries the stats to other counting points.
+ */
 template <typename Compare>
-struct ReverseCompare<Compare, false> {
-    constexpr ReverseCompare(Compare comp) : comp_{comp} {}
+struct ObservedCompare {
+    constexpr ObservedCompare(Compare comp, sort_stats* stats) : comp_{comp}, stats_{stats} {}
 
-    template <typename T>
-    constexpr bool operator()(T&& lhs, T&& rhs) {
-        return comp_(std::forward<T>(rhs), std::forward<T>(lhs));
+    template <typename T1, typename T2>
+    constexpr bool operator()(T1&& lhs, T2&& rhs) {
+        ++stats_->comparisons;
+        return comp_(std::forward<T1>(lhs), std::forward<T2>(rhs));
     }
 
+    constexpr sort_stats* Stats() const { return stats_; }
+
 private:
     Compare comp_;
+    sort_stats* stats_;
 };
 
+// Observation shouldn't change code paths; SIMD leaves are the exception, since they don't call the comparator.
+template <typename Compare, typename T>
+struct IsCheapCompare<ObservedCompare<Compare>, T> : IsCheapCompare<Compare, T> {};
+
 /**
- * @brief Helper to evenly divide array those length may not be power of 2
- *
- * The algorithm simulates real-number division. That is, when an array with its length `L` is
- * divided to `n` sequences, `i`-th sequence is the slice of the following range:
- *   [ floor(i * (L/n)) , floor((i+1) * (L/N)) ) .
- * Since `N` is power of 2, we can exactly compute the range by tracking the fractional part by an integer.
+ * @brief Accessor of stats carried by `Compare`. `Get` returns `nullptr_t` if there are none.
  */
-template <typename SsizeT, bool forward = true>
-struct SequenceDivider {
-    constexpr SequenceDivider(SsizeT data_len, SsizeT log2_num_seqs)
-        : log2_num_seqs{log2_num_seqs},
-          num_seqs{SsizeT{1} << log2_num_seqs},
-          remainder{(data_len - 1) % num_seqs + 1},
-          frac_counter{0} {
-        if constexpr (!forward) {
-            remainder = num_seqs - remainder;
-        }
+template <typename Compare>
+struct StatsOf {
+    static constexpr std::nullptr_t Get(const Compare&) { return nullptr; }
+};
+
+template <typename Compare>
+struct StatsOf<ObservedCompare<Compare>> {
+    static constexpr sort_stats* Get(const ObservedCompare<Compare>& comp) { return comp.Stats(); }
+};
+
+/**
+ * @brief Add `n` to the counter if `comp` carries stats; otherwise do nothing at all.
+ */
+template <typename Compare>
+constexpr void CountStat(const Compare& comp, std::uint64_t sort_stats::*counter, std::uint64_t n = 1) {
+    if constexpr (!std::is_null_pointer_v<decltype(StatsOf<Compare>::Get(comp))>) {
+        StatsOf<Compare>::Get(comp)->*counter += n;
     }
+}
 
-    constexpr bool Next() {
-        frac_counter += remainder;
-        bool no_carry = !(frac_counter & (SsizeT{1} << log2_num_seqs));
-        if constexpr (!forward) {
-            no_carry = !no_carry;
-        }
-        frac_counter &= ~(SsizeT{1} << log2_num_seqs);
-        --num_seqs;
-        return no_carry;
-    }
-
-    constexpr SsizeT IsEnd() const { return !num_seqs; }
-
-    SsizeT log2_num_seqs;
-    SsizeT num_seqs;
-    SsizeT remainder;
-    SsizeT frac_counter;
-};
-
-template <bool has_buf, bool forward, typename Iterator, typename Compare>
-SAYHISORT_CONSTEXPR_SWAP void MergeOneLevel(Iterator imit, Iterator buf, Iterator data, diff_t<Iterator> seq_len,
-                                            SequenceDivider<diff_t<Iterator>, forward> seq_div,
-                                            BlockingParam<diff_t<Iterator>> p, Compare comp) {
-    diff_t<Iterator> residual_len = p.first_block_len;
-    do {
-        bool lseq_decr = seq_div.Next();
-        bool rseq_decr = seq_div.Next();
-        diff_t<Iterator> merging_len = (seq_len - lseq_decr) + (seq_len - rseq_decr);
-        p.first_block_len = residual_len - lseq_decr;
-        p.last_block_len = residual_len - rseq_decr;
+template <typename Compare, typename SsizeT>
+constexpr void CountSwaps(const Compare& comp, SsizeT len) {
+    CountStat(comp, &sort_stats::swaps, static_cast<std::uint64_t>(len));
+}
 
-        if constexpr (forward) {
-            MergeBlocking<has_buf>(imit, buf, data, p, comp);
-            data += merging_len;
-        } else {
-            auto rev_imit = std::make_reverse_iterator(imit + p.num_blocks - 2);
-            auto rev_buf = std::make_reverse_iterator(buf);
-            auto rev_data = std::make_reverse_iterator(data);
-            MergeBlocking<has_buf>(rev_imit, rev_buf, rev_data, p, ReverseCompare{comp});
-            buf = rev_buf.base();
-            data -= merging_len;
-        }
-    } while (!seq_div.IsEnd());
+template <typename Compare, typename Iterator>
+constexpr void CountRotation(const Compare& comp, Iterator first, Iterator last) {
+    CountStat(comp, &sort_stats::rotations);
+    CountSwaps(comp, last - first);
 }
 
 //
-// Small array sorting
+// Basic merge routines
 //
 
+//! Initial number of consecutive wins of a sequence to switch to galloping mode in merging
+constexpr int kMinGallop = 7;
+//! Galloping is considered unfruitful if it finds a run shorter than this, as cross merge costs less for such a run
+constexpr int kMinFruitfulGallop = 24;
+
+template <typename Iterator>
+struct MergeResult {
+    bool xs_consumed;
+    Iterator rest;
+};
+
 /**
- * @brief Sort data by odd-even sort algorithm. Sorting is stable.
+ * @brief Merge adjacent sequences xs and ys into the buffer before xs. The buffer moves while merging.
  *
- * It's suitable for small data. Data length is passed as a template argument for generating specialized code.
+ * When xs or ys becomes empty, the function returns which of xs or ys is fully consumed, as well as
+ * the iterator to the rest data.
  *
- * @tparam len
- *   @pre len >= 0
- * @param data
+ * The sequence ys cannot be longer the the length of the buffer (because buffer overrun isn't checked.)
+ *
+ * @param buf
+ *   @pre buf < xs. We let buf_len = xs - buf.
+ *   @post rest - buf = buf_len.
+ * @param xs
+ *   @pre xs < ys
+ * @param ys
+ *   @pre ys < ys_last
+ *   @pre ys_last - ys <= buf_len
+ * @param ys_last
  * @param comp
+ * @return xs_consumed: Whether `rest` contains elements from `ys`.
+ * @return rest: Elements not merged.
+ *   @post xs < rest < ys_last
+ *
+ * @note The implementation actually works if xs or ys is empty, but the behaviour shall not be depended on.
  */
-template <int len, typename Iterator, typename Compare>
-SAYHISORT_CONSTEXPR_SWAP void OddEvenSort(Iterator data, Compare comp) {
-    for (diff_t<Iterator> i = 0; i < len; i += 2) {
-        for (diff_t<Iterator> j = 0; j < len - 1; j += 2) {
-            if (comp(data[j + 1], data[j])) {
-                swap(data[j], data[j + 1]);
+template <bool flipped, typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP MergeResult<Iterator> MergeWithBuf(Iterator& buf, Iterator xs, Iterator ys, Iterator ys_last,
+                                                            Compare comp) {
+    // Unless comparison is cheap, so-called cross merge optimization is applied
+    // See https://github.com/scandum/quadsort#cross-merge for idea
+    // In addition, when either of xs or ys wins many times in a row, the run is sought by galloping (like TimSort)
+    auto is_x_selected = [&comp](decltype(xs[0]) x, decltype(ys[0]) y) {
+        if constexpr (flipped) {
+            return comp(x, y);
+        } else {
+            return !comp(y, x);
+        }
+    };
+
+    Iterator xs_last = ys;
+    bool xs_consumed{};
+
+    if constexpr (kIsCheapCompare<Iterator, Compare>) {
+        // Branchless merge. Which of xs and ys advances is selected arithmetically, since compilers tend to emit
+        // a branch for a conditional operator.
+        while (xs < xs_last && ys < ys_last) {
+            bool x_selected = is_x_selected(xs[0], ys[0]);
+            Iterator src = ys + ((xs - ys) & -diff_t<Iterator>{x_selected});
+            swap(*buf++, *src);
+            xs += x_selected;
+            ys += !x_selected;
+        }
+        xs_consumed = xs == xs_last;
+
+    } else {
+        // Numbers of consecutive wins
+        diff_t<Iterator> x_wins = 0;
+        diff_t<Iterator> y_wins = 0;
+        // Galloping pays off only for long runs. The threshold increases whenever galloping is found unfruitful.
+        diff_t<Iterator> min_gallop = kMinGallop;
+        auto adapt_min_gallop = [&min_gallop](diff_t<Iterator> run_len) {
+            if (run_len < kMinFruitfulGallop) {
+                ++min_gallop;
+            } else if (min_gallop > kMinGallop) {
+                --min_gallop;
+            }
+        };
+
+        while (xs < xs_last - 1 && ys < ys_last - 1) {
+            if (x_wins >= min_gallop) {
+                Iterator x_upper = ExponentialSearch<!flipped>(xs, xs_last, ys, comp);
+                adapt_min_gallop(x_upper - xs);
+                CountSwaps(comp, x_upper - xs);
+                SwapRanges(buf, xs, x_upper - xs);
+                buf += x_upper - xs;
+                xs = x_upper;
+                x_wins = 0;
+            } else if (y_wins >= min_gallop) {
+                Iterator y_upper = ExponentialSearch<flipped>(ys, ys_last, xs, comp);
+                adapt_min_gallop(y_upper - ys);
+                CountSwaps(comp, y_upper - ys);
+                SwapRanges(buf, ys, y_upper - ys);
+                buf += y_upper - ys;
+                ys = y_upper;
+                y_wins = 0;
+            } else if (is_x_selected(xs[1], ys[0])) {
+                swap(*buf++, *xs++);
+                swap(*buf++, *xs++);
+                x_wins += 2;
+                y_wins = 0;
+            } else if (!is_x_selected(xs[0], ys[1])) {
+                swap(*buf++, *ys++);
+                swap(*buf++, *ys++);
+                x_wins = 0;
+                y_wins += 2;
+            } else {
+                bool y_pos = is_x_selected(xs[0], ys[0]);
+                swap(buf[!y_pos], *xs++);
+                swap(buf[y_pos], *ys++);
+                buf += 2;
+                x_wins = 0;
+                y_wins = 0;
             }
         }
-        if (i + 1 == len) {
-            break;
+
+        xs_consumed = xs == xs_last;
+
+        if (xs == xs_last - 1) {
+            xs_consumed = false;
+            do {
+                if (is_x_selected(xs[0], ys[0])) {
+                    swap(*buf++, *xs++);
+                    xs_consumed = true;
+                    break;
+                }
+                swap(*buf++, *ys++);
+            } while (ys < ys_last);
+
+        } else if (ys == ys_last - 1) {
+            xs_consumed = true;
+            do {
+                if (!is_x_selected(xs[0], ys[0])) {
+                    swap(*buf++, *ys++);
+                    xs_consumed = false;
+                    break;
+                }
+                swap(*buf++, *xs++);
+            } while (xs < xs_last);
         }
+    }
 
-        for (diff_t<Iterator> j = 1; j < len - 1; j += 2) {
-            if (comp(data[j + 1], data[j])) {
-                swap(data[j], data[j + 1]);
+    // Case: xs == xs_last
+    //    [ merged | buffer | buffer | right ]
+    //            buf       xs       ys    ys_last
+    if (xs_consumed) {
+        return {true, ys};
+    }
+
+    // Case: ys == ys_last
+    //    [ merged | buffer | left  | buffer ]
+    //            buf       xs   xs_last     ys
+    // -> After repeatedly applying swaps:
+    //    [ merged | buffer | buffer | left  ]
+    //            buf       xs       ys    ys_last
+    CountSwaps(comp, xs_last - xs);
+    SwapRangesBackward(ys, xs_last, xs_last - xs);
+    return {false, ys - (xs_last - xs)};
+}
+
+/**
+ * @brief Merge sequences xs and ys in-place.
+ *
+ * When xs or ys becomes empty, the function returns which of xs or ys is fully consumed, as well as
+ * the iterator to the rest data.
+ *
+ * @param xs
+ *   @pre xs < ys
+ * @param ys
+ *   @pre ys < ys_last
+ *   @post ys < ys_last
+ * @param ys_last
+ * @param comp
+ * @tparam search
+ *   Search for the next run of xs and ys. Runs are sought from their fronts, where they tend to end in block merges,
+ *   so exponential search takes O(log(run length)) comparisons instead of O(log(m + n)). If xs is much shorter than
+ *   ys, Hwang-Lin search takes about m * log2(n / m) comparisons in total.
+ * @note For better performance, `xs` should be not much longer than `ys`.
+ *       The time complexity is `O((m + log(n)) * min(m, n, j, k) + m + n)`, where
+ *       `m` and `n` are the lengthes of `xs` and `ys`, whereas `j` and `k` are
+ *       the numbers of unique keys in `xs` and `ys`.
+ */
+template <bool flipped, SearchKind search = SearchKind::kExponential, typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP MergeResult<Iterator> MergeWithoutBuf(Iterator xs, Iterator ys, Iterator ys_last,
+                                                               Compare comp) {
+    // xs is the shorter in Hwang-Lin merge, whose elements mostly stay in place
+    constexpr SearchKind xs_search = search == SearchKind::kHwangLin ? SearchKind::kExponential : search;
+
+    while (true) {
+        // Seek xs so that xs[0] > ys[0]
+        xs = Search<!flipped, xs_search>(xs, ys, ys, comp);
+        if (xs == ys) return {true, ys};
+        // Insert xs to ys
+        Iterator ys_upper = ys + 1;
+        if (ys_upper != ys_last) {
+            if constexpr (search == SearchKind::kHwangLin) {
+                ys_upper = HwangLinSearch<flipped>(ys_upper, ys_last, xs, ys - xs, comp);
+            } else {
+                ys_upper = Search<flipped, search>(ys_upper, ys_last, xs, comp);
             }
         }
+        CountRotation(comp, xs, ys_upper);
+        Rotate(xs, ys, ys_upper);
+        xs += ys_upper - ys;
+        ys = ys_upper;
+        if (ys_upper == ys_last) {
+            return {false, xs};
+        }
     }
 }
 
 /**
- * @brief Sort leaf sequences divided by bottom-up merge sorting.
+ * @brief Merge adjacent sequences xs and ys, using an external buffer which isn't a part of the sequences.
  *
- * @param data
- * @param seq_len
- *   @pre 5 <= seq_len <= 8; or seq_len == 4 and seq_div.Next() never returns true
- * @param seq_div
+ * Elements of xs are swapped out into the buffer first, then merged back with ys.
+ * The elements in the buffer are permuted in unspecified order.
+ *
+ * @param xs
+ *   @pre xs < ys
+ * @param ys
+ *   @pre ys < ys_last
+ * @param ys_last
+ * @param buf
+ *   @pre [buf, buf + (ys - xs)) is valid, and doesn't overlap with [xs, ys_last)
  * @param comp
  */
-template <typename Iterator, typename Compare>
-SAYHISORT_CONSTEXPR_SWAP void SortLeaves(Iterator data, diff_t<Iterator> seq_len,
-                                         SequenceDivider<diff_t<Iterator>> seq_div, Compare comp) {
+template <typename Iterator, typename BufIterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void MergeWithExtBuf(Iterator xs, Iterator ys, Iterator ys_last, BufIterator buf,
+                                              Compare comp) {
+    // Already merged
+    if (!comp(*ys, *(ys - 1))) {
+        return;
+    }
+    // Leading elements of xs not greater than ys[0] are already in place
+    xs = BinarySearch<true>(xs, ys, ys, comp);
+
+    BufIterator buf_last = buf + (ys - xs);
+    CountSwaps(comp, ys - xs);
+    SwapRanges(xs, buf, ys - xs);
+
+    Iterator out = xs;
     do {
-        bool decr = seq_div.Next();
-        diff_t<Iterator> len = seq_len - decr;
-        switch (len) {
-            case 4:
-                OddEvenSort<4>(data, comp);
-                break;
-            case 5:
-                OddEvenSort<5>(data, comp);
-                break;
-            case 6:
-                OddEvenSort<6>(data, comp);
-                break;
-            case 7:
-                OddEvenSort<7>(data, comp);
-                break;
-            case 8:
-                OddEvenSort<8>(data, comp);
-                break;
-            default:
-#if __GNUC__
-                __builtin_unreachable();
-#endif
-                break;
-        };
-        data += len;
-    } while (!seq_div.IsEnd());
+        if (comp(*ys, *buf)) {
+            swap(*out++, *ys++);
+        } else {
+            swap(*out++, *buf++);
+        }
+    } while (buf != buf_last && ys != ys_last);
+
+    CountSwaps(comp, buf_last - buf);
+    SwapRanges(out, buf, buf_last - buf);
 }
 
 /**
- * @brief Sort data with its length 0 to 8. Sorting is stable.
+ * @brief Merge adjacent sequences xs and ys into another range, from their heads and tails simultaneously.
  *
- * @param data
- * @param len
- *   @pre 0 <= len <= 8
+ * The front half of the output is merged from the heads, while the back half is merged from the tails. Since the two
+ * halves form independent dependency chains, out-of-order cores can run them in parallel.
+ * Elements originally in the output range are swapped into [xs, ys_last) in unspecified order.
+ *
+ * @param xs
+ *   @pre xs < ys
+ * @param ys
+ *   @pre ys < ys_last
+ * @param ys_last
+ * @param out
+ *   @pre [out, out + (ys_last - xs)) is valid, and doesn't overlap with [xs, ys_last)
  * @param comp
  */
-template <typename Iterator, typename Compare>
-SAYHISORT_CONSTEXPR_SWAP void Sort0To8(Iterator data, diff_t<Iterator> len, Compare comp) {
-    if (len <= 1) {
+template <typename Iterator, typename OutIterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void MergeBidirectional(Iterator xs, Iterator ys, Iterator ys_last, OutIterator out,
+                                                 Compare comp) {
+    // Already merged
+    if (!comp(*ys, *(ys - 1))) {
+        CountSwaps(comp, ys_last - xs);
+        SwapRanges(xs, out, ys_last - xs);
         return;
     }
-    if (len <= 3) {
-        if (comp(data[1], data[0])) {
-            swap(data[0], data[1]);
-        }
-        if (len == 2) {
-            return;
-        }
-        if (comp(data[2], data[1])) {
-            swap(data[1], data[2]);
+
+    OutIterator out_last = out + (ys_last - xs);
+    Iterator xs_last = ys;
+
+    // Slots consumed by either side get garbage swapped in. So each side has to check whether the other side has
+    // consumed all of xs or ys, before reading them. The check can be omitted while it's known to be passed.
+    auto merge_front = [&](auto checked) {
+        bool y_selected{};
+        if constexpr (checked) {
+            y_selected = ys != ys_last && (xs == xs_last || comp(*ys, *xs));
+        } else {
+            y_selected = comp(*ys, *xs);
         }
-        if (comp(data[1], data[0])) {
-            swap(data[0], data[1]);
+        Iterator src = xs + ((ys - xs) & -diff_t<Iterator>{y_selected});
+        swap(*out++, *src);
+        xs += !y_selected;
+        ys += y_selected;
+    };
+    auto merge_back = [&](auto checked) {
+        bool x_selected{};
+        if constexpr (checked) {
+            x_selected = xs != xs_last && (ys == ys_last || comp(ys_last[-1], xs_last[-1]));
+        } else {
+            x_selected = comp(ys_last[-1], xs_last[-1]);
         }
-        return;
+        Iterator src = ys_last + ((xs_last - ys_last) & -diff_t<Iterator>{x_selected});
+        swap(*--out_last, *--src);
+        xs_last -= x_selected;
+        ys_last -= !x_selected;
+    };
+
+    // After k steps from both ends, at most 2k elements of xs or ys are consumed.
+    diff_t<Iterator> min_len = (ys - xs) < (ys_last - ys) ? (ys - xs) : (ys_last - ys);
+    diff_t<Iterator> num_steps = (out_last - out) / 2;
+    diff_t<Iterator> num_unchecked_steps = min_len / 2;
+    num_steps -= num_unchecked_steps;
+    for (; num_unchecked_steps; --num_unchecked_steps) {
+        merge_front(std::false_type{});
+        merge_back(std::false_type{});
+    }
+    for (; num_steps; --num_steps) {
+        merge_front(std::true_type{});
+        merge_back(std::true_type{});
+    }
+    if (out != out_last) {
+        merge_front(std::true_type{});
     }
-    return SortLeaves(data, len, {len, diff_t<Iterator>{0}}, comp);
 }
 
-constexpr int kCiuraGaps[8] = {1, 4, 10, 23, 57, 132, 301, 701};
+/**
+ * @brief Merge adjacent sequences xs and ys of arbitrary lengths in-place, by recursively splitting and rotating.
+ *
+ * @param xs
+ *   @pre xs <= ys
+ * @param ys
+ *   @pre ys <= ys_last
+ * @param ys_last
+ * @param comp
+ * @note The time complexity is `O(N log(N))`, where `N = ys_last - xs`. It only needs `O(log(N))` stack.
+ */
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void MergeInPlace(Iterator xs, Iterator ys, Iterator ys_last, Compare comp) {
+    constexpr diff_t<Iterator> kMaxRotationMergeLen = 8;
+
+    while (xs != ys && ys != ys_last && comp(*ys, *(ys - 1))) {
+        diff_t<Iterator> xs_len = ys - xs;
+        diff_t<Iterator> ys_len = ys_last - ys;
+        if (xs_len <= kMaxRotationMergeLen || ys_len <= kMaxRotationMergeLen) {
+            MergeWithoutBuf<false>(xs, ys, ys_last, comp);
+            return;
+        }
+
+        // Split the longer sequence at its middle, and find the corresponding position in the other.
+        Iterator xs_cut;
+        Iterator ys_cut;
+        if (xs_len >= ys_len) {
+            xs_cut = xs + xs_len / 2;
+            ys_cut = BinarySearch<false>(ys, ys_last, xs_cut, comp);
+        } else {
+            ys_cut = ys + ys_len / 2;
+            xs_cut = BinarySearch<true>(xs, ys, ys_cut, comp);
+        }
+        CountRotation(comp, xs_cut, ys_cut);
+        Rotate(xs_cut, ys, ys_cut);
+        Iterator mid = xs_cut + (ys_cut - ys);
+
+        // Recurse into the shorter half, and loop for the other
+        if (mid - xs <= ys_last - mid) {
+            MergeInPlace(xs, xs_cut, mid, comp);
+            xs = mid;
+            ys = ys_cut;
+        } else {
+            MergeInPlace(mid, ys_cut, ys_last, comp);
+            ys = xs_cut;
+            ys_last = mid;
+        }
+    }
+}
+
+//
+// Block merge subroutines
+//
+
+/**
+ * @brief Interleave blocks from two sorted sequences, so that blocks are sorted by their first elements.
+ *
+ * @param imit
+ * @param blocks
+ *   @pre [imit, imit + num_left_blocks + num_right_blocks) and the blocks are non-overlapping
+ * @param num_left_blocks
+ *   @pre num_left_blocks is non-negative
+ * @param num_right_blocks
+ *   @pre num_right_blocks is non-negative
+ * @param block_len
+ *   @pre block_len is positive
+ * @param comp
+ * @return Key of the least right block.
+ */
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP Iterator InterleaveBlocks(Iterator imit, Iterator blocks, diff_t<Iterator> num_left_blocks,
+                                                   diff_t<Iterator> num_right_blocks, diff_t<Iterator> block_len,
+                                                   Compare comp) {
+    // Algorithm similar to wikisort's block movement
+    // https://github.com/BonzaiThePenguin/WikiSort/blob/master/Chapter%203.%20In-Place.md
+    //
+    // While interleaving, the state of blocks is like:
+    //   [interleaved | left_permuted | right]
+    // We pick the least block `least_left` from `left_permuted` by linear search.
+    // Then we compare `least_left` with `right[0]`, and swap the selected block for
+    // `left_permuted[0]`.
+    auto swapBlock = [block_len, &comp](Iterator a, Iterator b) {
+        if (a == b) {
+            return;
+        }
+        CountSwaps(comp, block_len);
+        SwapRanges(a, b, block_len);
+    };
+
+    Iterator left_keys = imit;
+    Iterator right_keys = imit + num_left_blocks;
+    Iterator left_blocks = blocks;
+    Iterator right_blocks = left_blocks + num_left_blocks * block_len;
+
+    Iterator least_left_key = left_keys;
+    Iterator least_left_block = left_blocks;
+
+    Iterator least_right_key = right_keys;
+    Iterator last_right_key = right_keys + num_right_blocks;
+
+    while (left_keys < right_keys) {
+        if (right_keys == last_right_key || !comp(*right_blocks, *least_left_block)) {
+            swap(*left_keys, *least_left_key);
+            swapBlock(left_blocks, least_left_block);
+
+            ++left_keys;
+            left_blocks += block_len;
+
+            least_left_key = left_keys;
+            least_left_block = left_blocks;
+            if (right_keys != least_right_key) {  // skip searching if left keys aren't permuted
+                for (Iterator key = left_keys + 1; key < right_keys; ++key) {
+                    if (comp(*key, *least_left_key)) {
+                        least_left_key = key;
+                    }
+                }
+                least_left_block = left_blocks + (least_left_key - left_keys) * block_len;
+            }
+
+        } else {
+            swap(*left_keys, *right_keys);
+            swapBlock(left_blocks, right_blocks);
+
+            if (left_keys == least_left_key) {
+                least_left_key = right_keys;
+                least_left_block = right_blocks;
+            }
+            if (right_keys == least_right_key) {
+                least_right_key = left_keys;
+            }
+            ++left_keys;
+            ++right_keys;
+            left_blocks += block_len;
+            right_blocks += block_len;
+        }
+    }
+
+    return least_right_key;
+}
+
+/**
+ * @brief Interleave blocks from two sorted sequences of the same number of blocks.
+ *
+ * @param imit
+ * @param blocks
+ *   @pre [imit, imit + num_blocks) and [blocks, bloks + num_blocks * block_len) are non-overlapping
+ * @param num_blocks
+ *   @pre num_blocks is non-negative and multiple of 2
+ * @param block_len
+ *   @pre block_len is positive
+ * @param comp
+ */
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP Iterator InterleaveBlocks(Iterator imit, Iterator blocks, diff_t<Iterator> num_blocks,
+                                                   diff_t<Iterator> block_len, Compare comp) {
+    return InterleaveBlocks(imit, blocks, num_blocks / 2, num_blocks / 2, block_len, comp);
+}
+
+/**
+ * @brief Sort interleaved keys in imitation buffer, using another auxiliary buffer.
+ *
+ * @param imit
+ * @param imit_len
+ *   @pre imit_len is positive
+ * @param buf
+ *   @pre [imit, imit + imit_len) and [buf, buf + k) are non-overlapping, where k is the number of right keys, which
+ *        is imit_len / 2 if both sequences have the same number of blocks
+ * @param mid_key
+ * @param comp
+ */
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void DeinterleaveImitation(Iterator imit, diff_t<Iterator> imit_len, Iterator buf,
+                                                    Iterator mid_key, Compare comp) {
+    // Bin-sort like algorithm based on partitioning.
+    // Same algorithm founds in HolyGrailsort.
+    // https://github.com/HolyGrailSortProject/Holy-Grailsort/blob/ccfcc4315c6ccafbca5f6a51886710898a06c8a1/Holy%20Grail%20Sort/Java/Summer%20Dragonfly%20et%20al.'s%20Rough%20Draft/src/holygrail/HolyGrailSort.java#L1328-L1330
+    swap(*mid_key, *buf);
+    Iterator left_cur = mid_key;
+    Iterator right_cur = buf + 1;
+    Iterator cur = mid_key + 1;
+    mid_key = buf;
+
+    while (cur != imit + imit_len) {
+        if (comp(*cur, *mid_key)) {
+            swap(*left_cur++, *cur++);
+        } else {
+            swap(*right_cur++, *cur++);
+        }
+    }
+
+    // Append right keys in `buf` to `left_cur`
+    CountSwaps(comp, right_cur - buf);
+    SwapRanges(left_cur, buf, right_cur - buf);
+}
+
+/**
+ * @brief Sort interleaved keys in imitation buffer, in-place.
+ *
+ * @param imit
+ * @param imit_len
+ *   @pre imit_len is positive
+ * @param mid_key
+ * @param comp
+ */
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void DeinterleaveImitation(Iterator imit, diff_t<Iterator> imit_len, Iterator mid_key,
+                                                    Compare comp) {
+    // We colour each key by whether they are from left or right.
+    // Then we can see the imitation buffer as a sequence of runs with alternating colour.
+    //
+    // In one iteration, the algorithm rotate every pair of (right, left)-runs.
+    // When no such a pair is found, all keys are properly sorted.
+    // Each iteration halves the number of pairs, So the alogirithm works in O(N log N), where
+    // N is size of `imit`.
+    //
+    // The idea to rotate pairs of runs of is borrowed from HolyGrailsort's algorithm.
+    // https://github.com/HolyGrailSortProject/Holy-Grailsort/blob/ccfcc4315c6ccafbca5f6a51886710898a06c8a1/Holy%20Grail%20Sort/Java/Summer%20Dragonfly%20et%20al.'s%20Rough%20Draft/src/holygrail/HolyGrailSort.java#L1373-L1376
+    diff_t<Iterator> runlengths[2] = {};
+    diff_t<Iterator>& l_runlength = runlengths[0];
+    diff_t<Iterator>& r_runlength = runlengths[1];
+
+    bool rotated{};
+    auto rotate_runs = [&](Iterator cur) {
+        if (!r_runlength) {
+            l_runlength = 0;
+            return;
+        }
+        Iterator l_run = cur - l_runlength;
+        Iterator r_run = l_run - r_runlength;
+        CountRotation(comp, r_run, cur);
+        Rotate(r_run, l_run, cur);
+        if (!rotated) {
+            mid_key = cur - r_runlength;
+        }
+        l_runlength = 0;
+        r_runlength = 0;
+        rotated = true;
+    };
+
+    do {
+        l_runlength = 0;
+        r_runlength = 0;
+        rotated = false;
+
+        bool was_left = false;
+        Iterator cur = imit;
+        do {
+            bool is_right = !comp(*cur, *mid_key);
+            if (was_left && is_right) {
+                rotate_runs(cur);
+            }
+            ++runlengths[is_right];
+            was_left = !is_right;
+        } while (++cur != imit + imit_len);
+
+        if (was_left) {
+            rotate_runs(cur);
+        }
+    } while (rotated);
+}
+
+//
+// Full block merge
+//
+
+template <typename SsizeT>
+struct BlockingParam {
+    SsizeT num_blocks;
+    SsizeT block_len;
+    SsizeT first_block_len;
+    SsizeT last_block_len;
+};
+
+template <bool has_buf, typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void MergeAdjacentBlocks(Iterator imit, Iterator& buf, Iterator blocks,
+                                                  BlockingParam<diff_t<Iterator>> p, Iterator mid_key, Compare comp) {
+    diff_t<Iterator> num_remained_blocks = p.num_blocks;
+
+    enum BlockOrigin {
+        kLeft,
+        kRight,
+    };
+
+    Iterator xs = blocks;
+    Iterator xs_latest_block = xs;
+    BlockOrigin xs_origin = kLeft;
+    --num_remained_blocks;
+
+    Iterator cur = xs + p.first_block_len;
+
+    do {
+        Iterator cur_last = cur + (--num_remained_blocks ? p.block_len : p.last_block_len);
+        BlockOrigin cur_origin = (num_remained_blocks && comp(*imit++, *mid_key)) ? kLeft : kRight;
+
+        if (cur_origin == xs_origin) {
+            xs_latest_block = cur;
+            cur = cur_last;
+            continue;
+        }
+
+        // Optimization to safely skip continuing blocks those have the same origin.
+        // In particular, it's crucial when `has_buf = false`. In this case, time complexity isn't assured
+        // without the optimization, due to implementation detail of `MergeWithoutBuf`.
+        if (xs != xs_latest_block) {
+            if constexpr (has_buf) {
+                if (num_remained_blocks) {
+                    CountSwaps(comp, xs_latest_block - xs);
+                    SwapRanges(buf, xs, xs_latest_block - xs);
+                    buf += xs_latest_block - xs;
+                    xs = xs_latest_block;
+                }
+            } else {
+                if (num_remained_blocks) {
+                    xs = xs_latest_block;
+                } else if (cur - xs > p.last_block_len) {
+                    // Ensure that length of xs is at most block_len
+                    CountRotation(comp, xs, cur_last);
+                    Rotate(xs, cur, cur_last);
+                    cur = xs + p.last_block_len;
+                    xs_origin = kRight;
+                }
+            }
+        }
+
+        MergeResult mr = ([&]() {
+            if constexpr (has_buf) {
+                if (xs_origin == kLeft) {
+                    return MergeWithBuf<false>(buf, xs, cur, cur_last, comp);
+                } else {
+                    return MergeWithBuf<true>(buf, xs, cur, cur_last, comp);
+                }
+            } else {
+                if (xs_origin == kLeft) {
+                    return MergeWithoutBuf<false>(xs, cur, cur_last, comp);
+                } else {
+                    return MergeWithoutBuf<true>(xs, cur, cur_last, comp);
+                }
+            }
+        })();
+
+        xs = mr.rest;
+        xs_latest_block = xs;
+        xs_origin = static_cast<BlockOrigin>(static_cast<bool>(xs_origin) ^ mr.xs_consumed);
+
+        cur = cur_last;
+    } while (num_remained_blocks);
+
+    if constexpr (has_buf) {
+        CountRotation(comp, buf, cur);
+        Rotate(buf, xs, cur);
+        buf += cur - xs;
+    }
+}
+
+/**
+ * @brief Merge a left sequence of `num_left_blocks + 1` blocks and a right one of the rest, by block merge.
+ *
+ * The first block and the last one may be shorter than the others. Both sequences need another block besides them,
+ * so `num_left_blocks < p.num_blocks - 1`. The buffer, if any, needs at least `block_len` elements and as many as the
+ * right blocks; it's moved to the end.
+ */
+template <bool has_buf, typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void MergeBlocking(Iterator imit, Iterator& buf, Iterator blocks,
+                                            BlockingParam<diff_t<Iterator>> p, diff_t<Iterator> num_left_blocks,
+                                            Compare comp) {
+    // Skip interleaving the first block and the last one, those may have shorter length.
+    diff_t<Iterator> imit_len = p.num_blocks - 2;
+    Iterator mid_key = InterleaveBlocks(imit, blocks + p.first_block_len, num_left_blocks - 1,
+                                        imit_len - (num_left_blocks - 1), p.block_len, comp);
+
+    MergeAdjacentBlocks<has_buf>(imit, buf, blocks, p, mid_key, comp);
+    if (!imit_len) {
+        return;
+    }
+
+    if constexpr (has_buf) {
+        DeinterleaveImitation(imit, imit_len, buf, mid_key, comp);
+    } else {
+        DeinterleaveImitation(imit, imit_len, mid_key, comp);
+    }
+}
+
+template <bool has_buf, typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void MergeBlocking(Iterator imit, Iterator& buf, Iterator blocks,
+                                            BlockingParam<diff_t<Iterator>> p, Compare comp) {
+    MergeBlocking<has_buf>(imit, buf, blocks, p, p.num_blocks / 2, comp);
+}
+
+//
+// Bottom-up merge sort logics
+//
+
+template <typename Compare, bool = std::is_empty_v<Compare> && !std::is_final_v<Compare>>
+struct ReverseCompare : Compare {
+    constexpr ReverseCompare(Compare comp) : Compare(comp) {}
+
+    template <typename T>
+    constexpr bool operator()(T&& lhs, T&& rhs) {
+        return Compare::operator()(std::forward<T>(rhs), std::forward<T>(lhs));
+    }
+
+    constexpr const Compare& Base() const { return *this; }
+};
+
+template <typename Compare>
+struct ReverseCompare<Compare, false> {
+    constexpr ReverseCompare(Compare comp) : comp_{comp} {}
+
+    template <typename T>
+    constexpr bool operator()(T&& lhs, T&& rhs) {
+        return comp_(std::forward<T>(rhs), std::forward<T>(lhs));
+    }
+
+    constexpr const Compare& Base() const { return comp_; }
+
+private:
+    Compare comp_;
+};
+
+template <typename Compare, typename T>
+struct IsCheapCompare<ReverseCompare<Compare>, T> : IsCheapCompare<Compare, T> {};
+
+template <typename Compare>
+struct StatsOf<ReverseCompare<Compare>> {
+    static constexpr auto Get(const ReverseCompare<Compare>& comp) { return StatsOf<Compare>::Get(comp.Base()); }
+};
+
+/**
+ * @brief Helper to evenly divide array those length may not be power of 2
+ *
+ * The algorithm simulates real-number division. That is, when an array with its length `L` is
+ * divided to `n` sequences, `i`-th sequence is the slice of the following range:
+ *   [ floor(i * (L/n)) , floor((i+1) * (L/N)) ) .
+ * Since `N` is power of 2, we can exactly compute the range by tracking the fractional part by an integer.
+ */
+template <typename SsizeT, bool forward = true>
+struct SequenceDivider {
+    constexpr SequenceDivider(SsizeT data_len, SsizeT log2_num_seqs)
+        : log2_num_seqs{log2_num_seqs},
+          num_seqs{SsizeT{1} << log2_num_seqs},
+          remainder{(data_len - 1) % num_seqs + 1},
+          frac_counter{0} {
+        if constexpr (!forward) {
+            remainder = num_seqs - remainder;
+        }
+    }
+
+    constexpr bool Next() {
+        frac_counter += remainder;
+        bool no_carry = !(frac_counter & (SsizeT{1} << log2_num_seqs));
+        if constexpr (!forward) {
+            no_carry = !no_carry;
+        }
+        frac_counter &= ~(SsizeT{1} << log2_num_seqs);
+        --num_seqs;
+        return no_carry;
+    }
+
+    constexpr SsizeT IsEnd() const { return !num_seqs; }
+
+    SsizeT log2_num_seqs;
+    SsizeT num_seqs;
+    SsizeT remainder;
+    SsizeT frac_counter;
+};
+
+template <bool has_buf, bool forward, typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void MergeOneLevel(Iterator imit, Iterator buf, Iterator data, diff_t<Iterator> seq_len,
+                                            SequenceDivider<diff_t<Iterator>, forward> seq_div,
+                                            BlockingParam<diff_t<Iterator>> p, Compare comp) {
+    diff_t<Iterator> residual_len = p.first_block_len;
+    do {
+        bool lseq_decr = seq_div.Next();
+        bool rseq_decr = seq_div.Next();
+        diff_t<Iterator> merging_len = (seq_len - lseq_decr) + (seq_len - rseq_decr);
+        p.first_block_len = residual_len - lseq_decr;
+        p.last_block_len = residual_len - rseq_decr;
+
+        if constexpr (forward) {
+            MergeBlocking<has_buf>(imit, buf, data, p, comp);
+            data += merging_len;
+        } else {
+            auto rev_imit = std::make_reverse_iterator(imit + p.num_blocks - 2);
+            auto rev_buf = std::make_reverse_iterator(buf);
+            auto rev_data = std::make_reverse_iterator(data);
+            MergeBlocking<has_buf>(rev_imit, rev_buf, rev_data, p, ReverseCompare{comp});
+            buf = rev_buf.base();
+            data -= merging_len;
+        }
+    } while (!seq_div.IsEnd());
+}
+
+/**
+ * @brief Merge each pair of adjacent sequences, using an external buffer.
+ *
+ * @param data
+ * @param seq_len
+ * @param seq_div
+ * @param buf
+ *   @pre [buf, buf + seq_len) is valid, and doesn't overlap with data
+ * @param comp
+ */
+template <typename Iterator, typename BufIterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void MergeOneLevelWithExtBuf(Iterator data, diff_t<Iterator> seq_len,
+                                                      SequenceDivider<diff_t<Iterator>> seq_div, BufIterator buf,
+                                                      Compare comp) {
+    do {
+        bool lseq_decr = seq_div.Next();
+        bool rseq_decr = seq_div.Next();
+        Iterator mid = data + (seq_len - lseq_decr);
+        Iterator last = mid + (seq_len - rseq_decr);
+        MergeWithExtBuf(data, mid, last, buf, comp);
+        data = last;
+    } while (!seq_div.IsEnd());
+}
+
+/**
+ * @brief Merge each pair of adjacent sequences into another range, which the sequences are merged back later.
+ *
+ * @param data
+ * @param seq_len
+ * @param seq_div
+ * @param out
+ *   @pre [out, out + data_len) is valid, and doesn't overlap with data
+ * @param comp
+ */
+template <typename Iterator, typename OutIterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void MergeOneLevelOutOfPlace(Iterator data, diff_t<Iterator> seq_len,
+                                                      SequenceDivider<diff_t<Iterator>> seq_div, OutIterator out,
+                                                      Compare comp) {
+    do {
+        bool lseq_decr = seq_div.Next();
+        bool rseq_decr = seq_div.Next();
+        Iterator mid = data + (seq_len - lseq_decr);
+        Iterator last = mid + (seq_len - rseq_decr);
+        MergeBidirectional(data, mid, last, out, comp);
+        out += last - data;
+        data = last;
+    } while (!seq_div.IsEnd());
+}
+
+//
+// SIMD leaf sorting
+//
+
+/**
+ * @brief Primitive operations on SIMD registers, specialized for each instruction set and element type.
+ *
+ * A specialization provides the following members, all of which are compiled for the instruction set:
+ *   - `Reg`: register type holding `kLanes` elements
+ *   - `Fill(v, x)`: broadcast `x` to all lanes of `v`
+ *   - `Load(v, p, n, pad)`: load `min(n, kLanes)` elements from `p` to `v`, filling the remaining lanes by `pad`
+ *   - `Store(p, n, v)`: store first `min(n, kLanes)` elements of `v` to `p`
+ *   - `Sort2(a, b)`: lane-wise minimum to `a` and maximum to `b`
+ *   - `Transpose(rows)`: transpose `kLanes` registers as a square matrix in place
+ */
+template <SimdIsa isa, typename T, std::size_t = sizeof(T)>
+struct SimdLeafOps {
+    static constexpr bool kAvailable = false;
+};
+
+#if SAYHISORT_RUNTIME_DISPATCH || defined(__AVX512F__)
+
+// Only 8-byte elements; 16 lanes of 4-byte elements are too wide for leaves of 8 elements, and AVX2 does well for them.
+template <typename T>
+struct SimdLeafOps<SimdIsa::kAvx512, T, 8> {
+    static constexpr bool kAvailable = true;
+    static constexpr int kLanes = 8;
+    using Reg = __m512i;
+    // Operations are masked by all lanes, since unmasked ones fall foul of -Wuninitialized in some versions of GCC
+    static constexpr __mmask8 kAll = 0xFF;
+
+    SAYHISORT_TARGET("avx512f") static void Fill(Reg& v, T x) { v = _mm512_set1_epi64(static_cast<long long>(x)); }
+
+    SAYHISORT_TARGET("avx512f") static void Load(Reg& v, const T* p, int n, T pad) {
+        if (n >= kLanes) {
+            v = _mm512_loadu_si512(p);
+            return;
+        }
+        auto mask = static_cast<__mmask8>((1u << n) - 1);
+        v = _mm512_mask_loadu_epi64(_mm512_set1_epi64(static_cast<long long>(pad)), mask, p);
+    }
+
+    SAYHISORT_TARGET("avx512f") static void Store(T* p, int n, const Reg& v) {
+        if (n >= kLanes) {
+            _mm512_storeu_si512(p, v);
+            return;
+        }
+        _mm512_mask_storeu_epi64(p, static_cast<__mmask8>((1u << n) - 1), v);
+    }
+
+    SAYHISORT_TARGET("avx512f") static void Sort2(Reg& a, Reg& b) {
+        Reg lo, hi;
+        if constexpr (std::is_signed_v<T>) {
+            lo = _mm512_maskz_min_epi64(kAll, a, b);
+            hi = _mm512_maskz_max_epi64(kAll, a, b);
+        } else {
+            lo = _mm512_maskz_min_epu64(kAll, a, b);
+            hi = _mm512_maskz_max_epu64(kAll, a, b);
+        }
+        a = lo;
+        b = hi;
+    }
+
+    SAYHISORT_TARGET("avx512f") static void Transpose(Reg* rows) {
+        Reg t[8];
+        for (int i = 0; i < 8; i += 2) {
+            t[i] = _mm512_maskz_unpacklo_epi64(kAll, rows[i], rows[i + 1]);
+            t[i + 1] = _mm512_maskz_unpackhi_epi64(kAll, rows[i], rows[i + 1]);
+        }
+        // 128-bit lanes of t[i] hold pairs of columns 0, 2, 4, 6 for even i, and 1, 3, 5, 7 for odd i
+        for (int i = 0; i < 2; ++i) {
+            Reg u0 = _mm512_maskz_shuffle_i64x2(kAll, t[i], t[i + 2], 0x88);
+            Reg u1 = _mm512_maskz_shuffle_i64x2(kAll, t[i], t[i + 2], 0xDD);
+            Reg u2 = _mm512_maskz_shuffle_i64x2(kAll, t[i + 4], t[i + 6], 0x88);
+            Reg u3 = _mm512_maskz_shuffle_i64x2(kAll, t[i + 4], t[i + 6], 0xDD);
+            rows[i] = _mm512_maskz_shuffle_i64x2(kAll, u0, u2, 0x88);
+            rows[i + 2] = _mm512_maskz_shuffle_i64x2(kAll, u1, u3, 0x88);
+            rows[i + 4] = _mm512_maskz_shuffle_i64x2(kAll, u0, u2, 0xDD);
+            rows[i + 6] = _mm512_maskz_shuffle_i64x2(kAll, u1, u3, 0xDD);
+        }
+    }
+};
+
+#endif
+
+#if SAYHISORT_RUNTIME_DISPATCH || defined(__AVX2__)
+
+template <typename T>
+struct SimdLeafOps<SimdIsa::kAvx2, T, 4> {
+    static constexpr bool kAvailable = true;
+    static constexpr int kLanes = 8;
+    using Reg = __m256i;
+
+    SAYHISORT_TARGET("avx2") static void Fill(Reg& v, T x) { v = _mm256_set1_epi32(static_cast<int>(x)); }
+
+    SAYHISORT_TARGET("avx2") static void Load(Reg& v, const T* p, int n, T pad) {
+        if (n >= kLanes) {
+            v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            return;
+        }
+        Reg mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(n), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        Reg loaded = _mm256_maskload_epi32(reinterpret_cast<const int*>(p), mask);
+        v = _mm256_blendv_epi8(_mm256_set1_epi32(static_cast<int>(pad)), loaded, mask);
+    }
+
+    SAYHISORT_TARGET("avx2") static void Store(T* p, int n, const Reg& v) {
+        if (n >= kLanes) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+            return;
+        }
+        Reg mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(n), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        _mm256_maskstore_epi32(reinterpret_cast<int*>(p), mask, v);
+    }
+
+    SAYHISORT_TARGET("avx2") static void Sort2(Reg& a, Reg& b) {
+        Reg lo, hi;
+        if constexpr (std::is_signed_v<T>) {
+            lo = _mm256_min_epi32(a, b);
+            hi = _mm256_max_epi32(a, b);
+        } else {
+            lo = _mm256_min_epu32(a, b);
+            hi = _mm256_max_epu32(a, b);
+        }
+        a = lo;
+        b = hi;
+    }
+
+    SAYHISORT_TARGET("avx2") static void Transpose(Reg* rows) {
+        Reg t[8];
+        for (int i = 0; i < 8; i += 2) {
+            t[i] = _mm256_unpacklo_epi32(rows[i], rows[i + 1]);
+            t[i + 1] = _mm256_unpackhi_epi32(rows[i], rows[i + 1]);
+        }
+        Reg u[8];
+        for (int i = 0; i < 8; i += 4) {
+            u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+            u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+            u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+            u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+        }
+        for (int i = 0; i < 4; ++i) {
+            rows[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+            rows[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+        }
+    }
+};
+
+template <typename T>
+struct SimdLeafOps<SimdIsa::kAvx2, T, 8> {
+    static constexpr bool kAvailable = true;
+    static constexpr int kLanes = 4;
+    using Reg = __m256i;
+
+    SAYHISORT_TARGET("avx2") static void Fill(Reg& v, T x) { v = _mm256_set1_epi64x(static_cast<long long>(x)); }
+
+    SAYHISORT_TARGET("avx2") static void Load(Reg& v, const T* p, int n, T pad) {
+        if (n >= kLanes) {
+            v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            return;
+        }
+        Reg mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(n), _mm256_setr_epi64x(0, 1, 2, 3));
+        Reg loaded = _mm256_maskload_epi64(reinterpret_cast<const long long*>(p), mask);
+        v = _mm256_blendv_epi8(_mm256_set1_epi64x(static_cast<long long>(pad)), loaded, mask);
+    }
+
+    SAYHISORT_TARGET("avx2") static void Store(T* p, int n, const Reg& v) {
+        if (n >= kLanes) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+            return;
+        }
+        Reg mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(n), _mm256_setr_epi64x(0, 1, 2, 3));
+        _mm256_maskstore_epi64(reinterpret_cast<long long*>(p), mask, v);
+    }
+
+    // AVX2 lacks min/max and unsigned comparison of 64-bit lanes, so sign bits are flipped for unsigned types
+    SAYHISORT_TARGET("avx2") static void Sort2(Reg& a, Reg& b) {
+        Reg greater;
+        if constexpr (std::is_signed_v<T>) {
+            greater = _mm256_cmpgt_epi64(a, b);
+        } else {
+            Reg sign = _mm256_set1_epi64x(std::numeric_limits<long long>::min());
+            greater = _mm256_cmpgt_epi64(_mm256_xor_si256(a, sign), _mm256_xor_si256(b, sign));
+        }
+        Reg lo = _mm256_blendv_epi8(a, b, greater);
+        b = _mm256_blendv_epi8(b, a, greater);
+        a = lo;
+    }
+
+    SAYHISORT_TARGET("avx2") static void Transpose(Reg* rows) {
+        Reg t0 = _mm256_unpacklo_epi64(rows[0], rows[1]);
+        Reg t1 = _mm256_unpackhi_epi64(rows[0], rows[1]);
+        Reg t2 = _mm256_unpacklo_epi64(rows[2], rows[3]);
+        Reg t3 = _mm256_unpackhi_epi64(rows[2], rows[3]);
+        rows[0] = _mm256_permute2x128_si256(t0, t2, 0x20);
+        rows[1] = _mm256_permute2x128_si256(t1, t3, 0x20);
+        rows[2] = _mm256_permute2x128_si256(t0, t2, 0x31);
+        rows[3] = _mm256_permute2x128_si256(t1, t3, 0x31);
+    }
+};
+
+#endif
+
+#if SAYHISORT_RUNTIME_DISPATCH || defined(__SSE4_1__)
+
+template <typename T>
+struct SimdLeafOps<SimdIsa::kSse41, T, 4> {
+    static constexpr bool kAvailable = true;
+    static constexpr int kLanes = 4;
+    using Reg = __m128i;
+
+    SAYHISORT_TARGET("sse4.1") static void Fill(Reg& v, T x) { v = _mm_set1_epi32(static_cast<int>(x)); }
+
+    SAYHISORT_TARGET("sse4.1") static void Load(Reg& v, const T* p, int n, T pad) {
+        if (n >= kLanes) {
+            v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            return;
+        }
+        // SSE has no masked load; go through a padded temporary
+        T tmp[kLanes] = {pad, pad, pad, pad};
+        std::memcpy(tmp, p, sizeof(T) * n);
+        v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tmp));
+    }
+
+    SAYHISORT_TARGET("sse4.1") static void Store(T* p, int n, const Reg& v) {
+        if (n >= kLanes) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+            return;
+        }
+        T tmp[kLanes];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(tmp), v);
+        std::memcpy(p, tmp, sizeof(T) * n);
+    }
+
+    SAYHISORT_TARGET("sse4.1") static void Sort2(Reg& a, Reg& b) {
+        Reg lo, hi;
+        if constexpr (std::is_signed_v<T>) {
+            lo = _mm_min_epi32(a, b);
+            hi = _mm_max_epi32(a, b);
+        } else {
+            lo = _mm_min_epu32(a, b);
+            hi = _mm_max_epu32(a, b);
+        }
+        a = lo;
+        b = hi;
+    }
+
+    SAYHISORT_TARGET("sse4.1") static void Transpose(Reg* rows) {
+        Reg t0 = _mm_unpacklo_epi32(rows[0], rows[1]);
+        Reg t1 = _mm_unpacklo_epi32(rows[2], rows[3]);
+        Reg t2 = _mm_unpackhi_epi32(rows[0], rows[1]);
+        Reg t3 = _mm_unpackhi_epi32(rows[2], rows[3]);
+        rows[0] = _mm_unpacklo_epi64(t0, t1);
+        rows[1] = _mm_unpackhi_epi64(t0, t1);
+        rows[2] = _mm_unpacklo_epi64(t2, t3);
+        rows[3] = _mm_unpackhi_epi64(t2, t3);
+    }
+};
+
+#endif
+
+/**
+ * @brief The most capable instruction set which has SIMD operations on `T` and is supported by the CPU.
+ */
+template <typename T>
+SimdIsa SimdLeafIsa() {
+    SimdIsa cpu = CpuSimdIsa();
+    if (SimdLeafOps<SimdIsa::kAvx512, T>::kAvailable && cpu >= SimdIsa::kAvx512) {
+        return SimdIsa::kAvx512;
+    }
+    if (SimdLeafOps<SimdIsa::kAvx2, T>::kAvailable && cpu >= SimdIsa::kAvx2) {
+        return SimdIsa::kAvx2;
+    }
+    if (SimdLeafOps<SimdIsa::kSse41, T>::kAvailable && cpu >= SimdIsa::kSse41) {
+        return SimdIsa::kSse41;
+    }
+    return SimdIsa::kNone;
+}
+
+/**
+ * @brief Whether leaf sequences may be sorted by SIMD sorting networks, if the CPU supports an instruction set for them.
+ *
+ * Only integral types are eligible: sorting networks are unstable, and equivalent integers are indistinguishable,
+ * whereas floating-point numbers aren't (e.g., -0.0 and +0.0).
+ */
+template <typename Iterator, typename Compare,
+          typename T = std::remove_cv_t<typename std::iterator_traits<Iterator>::value_type>>
+constexpr bool kHasSimdLeaves =
+    std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+    (SimdLeafOps<SimdIsa::kSse41, T>::kAvailable || SimdLeafOps<SimdIsa::kAvx2, T>::kAvailable ||
+     SimdLeafOps<SimdIsa::kAvx512, T>::kAvailable) &&
+    kBuiltinOrder<Compare, T> != 0 && kIsContiguousIterator<Iterator>;
+
+/**
+ * @brief Batcher's odd-even merge sorting network for `len` elements.
+ *
+ * @tparam len
+ *   @pre len is power of 2
+ */
+template <int len>
+struct OddEvenMergeNetwork {
+    static constexpr int CountComparators() {
+        int n = 0;
+        for (int p = 1; p < len; p *= 2) {
+            for (int k = p; k >= 1; k /= 2) {
+                for (int j = k % p; j + k < len; j += 2 * k) {
+                    for (int i = 0; i < k; ++i) {
+                        n += (i + j) / (p * 2) == (i + j + k) / (p * 2);
+                    }
+                }
+            }
+        }
+        return n;
+    }
+
+    static constexpr int kSize = CountComparators();
+
+    constexpr OddEvenMergeNetwork() {
+        int n = 0;
+        for (int p = 1; p < len; p *= 2) {
+            for (int k = p; k >= 1; k /= 2) {
+                for (int j = k % p; j + k < len; j += 2 * k) {
+                    for (int i = 0; i < k; ++i) {
+                        if ((i + j) / (p * 2) == (i + j + k) / (p * 2)) {
+                            lhs[n] = i + j;
+                            rhs[n] = i + j + k;
+                            ++n;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    int lhs[kSize]{};
+    int rhs[kSize]{};
+};
+
+template <typename Ops, bool descending, int len, std::size_t... Is>
+inline void ApplySortingNetwork(typename Ops::Reg* v, std::index_sequence<Is...>) {
+    constexpr OddEvenMergeNetwork<len> net{};
+    if constexpr (descending) {
+        (Ops::Sort2(v[net.rhs[Is]], v[net.lhs[Is]]), ...);
+    } else {
+        (Ops::Sort2(v[net.lhs[Is]], v[net.rhs[Is]]), ...);
+    }
+}
+
+/**
+ * @brief Sort leaf sequences by a SIMD sorting network, `kLanes` leaves at a time.
+ *
+ * Each leaf is loaded to a row, padded by the greatest value in the sort order, and rows are transposed to columns.
+ * Then the network consists of vertical min/max operations only, so that no shuffles are required in its body.
+ *
+ * @tparam Ops
+ * @tparam leaf_len
+ * @param data
+ * @param seq_len
+ *   @pre seq_len <= leaf_len
+ * @param seq_div
+ */
+template <typename Ops, int leaf_len, bool descending, typename T, typename SsizeT>
+void SimdSortLeaves(T* data, SsizeT seq_len, SequenceDivider<SsizeT> seq_div) {
+    using Reg = typename Ops::Reg;
+    constexpr int kLanes = Ops::kLanes;
+    static_assert(leaf_len % kLanes == 0);
+
+    constexpr T pad = descending ? std::numeric_limits<T>::lowest() : std::numeric_limits<T>::max();
+
+    do {
+        T* rows[kLanes]{};
+        int lens[kLanes]{};
+        int num_rows = 0;
+        for (; num_rows < kLanes && !seq_div.IsEnd(); ++num_rows) {
+            rows[num_rows] = data;
+            lens[num_rows] = static_cast<int>(seq_len - seq_div.Next());
+            data += lens[num_rows];
+        }
+
+        Reg v[leaf_len];
+        for (int j = 0; j < leaf_len; j += kLanes) {
+            for (int i = 0; i < kLanes; ++i) {
+                if (i < num_rows && j < lens[i]) {
+                    Ops::Load(v[j + i], rows[i] + j, lens[i] - j, pad);
+                } else {
+                    Ops::Fill(v[j + i], pad);
+                }
+            }
+            Ops::Transpose(v + j);
+        }
+
+        ApplySortingNetwork<Ops, descending, leaf_len>(
+            v, std::make_index_sequence<OddEvenMergeNetwork<leaf_len>::kSize>{});
+
+        for (int j = 0; j < leaf_len; j += kLanes) {
+            Ops::Transpose(v + j);
+            for (int i = 0; i < num_rows; ++i) {
+                if (j < lens[i]) {
+                    Ops::Store(rows[i] + j, lens[i] - j, v[j + i]);
+                }
+            }
+        }
+    } while (!seq_div.IsEnd());
+}
+
+/**
+ * @brief Entry points of `SimdSortLeaves` compiled for each instruction set, into which the whole kernel is inlined.
+ */
+template <SimdIsa isa>
+struct SimdLeafKernel;
+
+template <>
+struct SimdLeafKernel<SimdIsa::kSse41> {
+    template <int leaf_len, bool descending, typename T, typename SsizeT>
+    SAYHISORT_TARGET("sse4.1") SAYHISORT_FLATTEN static void Run(T* data, SsizeT seq_len,
+                                                                 SequenceDivider<SsizeT> seq_div) {
+        SimdSortLeaves<SimdLeafOps<SimdIsa::kSse41, T>, leaf_len, descending>(data, seq_len, seq_div);
+    }
+};
+
+template <>
+struct SimdLeafKernel<SimdIsa::kAvx2> {
+    template <int leaf_len, bool descending, typename T, typename SsizeT>
+    SAYHISORT_TARGET("avx2") SAYHISORT_FLATTEN static void Run(T* data, SsizeT seq_len,
+                                                               SequenceDivider<SsizeT> seq_div) {
+        SimdSortLeaves<SimdLeafOps<SimdIsa::kAvx2, T>, leaf_len, descending>(data, seq_len, seq_div);
+    }
+};
+
+template <>
+struct SimdLeafKernel<SimdIsa::kAvx512> {
+    template <int leaf_len, bool descending, typename T, typename SsizeT>
+    SAYHISORT_TARGET("avx512f") SAYHISORT_FLATTEN static void Run(T* data, SsizeT seq_len,
+                                                                  SequenceDivider<SsizeT> seq_div) {
+        SimdSortLeaves<SimdLeafOps<SimdIsa::kAvx512, T>, leaf_len, descending>(data, seq_len, seq_div);
+    }
+};
+
+/**
+ * @brief Sort leaf sequences by the SIMD sorting network of the shortest sufficient length for `isa`.
+ *
+ * @tparam isa
+ *   @pre SimdLeafOps<isa, T>::kAvailable, and the CPU supports isa
+ * @param data
+ * @param seq_len
+ *   @pre seq_len <= SAYHISORT_SIMD_LEAF_LEN
+ * @param seq_div
+ */
+template <SimdIsa isa, bool descending, typename T, typename SsizeT>
+void SimdSortLeavesFor(T* data, SsizeT seq_len, SequenceDivider<SsizeT> seq_div) {
+    if constexpr (SimdLeafOps<isa, T>::kAvailable) {
+        if (seq_len <= 8) {
+            return SimdLeafKernel<isa>::template Run<8, descending>(data, seq_len, seq_div);
+        }
+#if SAYHISORT_SIMD_LEAF_LEN >= 16
+        if (seq_len <= 16) {
+            return SimdLeafKernel<isa>::template Run<16, descending>(data, seq_len, seq_div);
+        }
+#endif
+#if SAYHISORT_SIMD_LEAF_LEN >= 32
+        return SimdLeafKernel<isa>::template Run<32, descending>(data, seq_len, seq_div);
+#endif
+    }
+}
+
+/**
+ * @brief Maximum length of leaf sequences, which depends on whether SIMD sorting networks are available for the CPU.
+ */
+template <typename Iterator, typename Compare>
+constexpr diff_t<Iterator> MaxLeafLen() {
+    static_assert(SAYHISORT_SIMD_LEAF_LEN == 8 || SAYHISORT_SIMD_LEAF_LEN == 16 || SAYHISORT_SIMD_LEAF_LEN == 32);
+    if constexpr (kHasSimdLeaves<Iterator, Compare>) {
+        using T = std::remove_cv_t<typename std::iterator_traits<Iterator>::value_type>;
+        if (!IsConstantEvaluated() && SimdLeafIsa<T>() != SimdIsa::kNone) {
+            return SAYHISORT_SIMD_LEAF_LEN;
+        }
+    }
+    return 8;
+}
+
+//
+// Small array sorting
+//
+
+/**
+ * @brief Sort data by odd-even sort algorithm. Sorting is stable.
+ *
+ * It's suitable for small data. Data length is passed as a template argument for generating specialized code.
+ *
+ * @tparam len
+ *   @pre len >= 0
+ * @param data
+ * @param comp
+ */
+template <int len, typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void OddEvenSort(Iterator data, Compare comp) {
+    for (diff_t<Iterator> i = 0; i < len; i += 2) {
+        for (diff_t<Iterator> j = 0; j < len - 1; j += 2) {
+            if (comp(data[j + 1], data[j])) {
+                swap(data[j], data[j + 1]);
+            }
+        }
+        if (i + 1 == len) {
+            break;
+        }
+
+        for (diff_t<Iterator> j = 1; j < len - 1; j += 2) {
+            if (comp(data[j + 1], data[j])) {
+                swap(data[j], data[j + 1]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Sort leaf sequences divided by bottom-up merge sorting.
+ *
+ * @param data
+ * @param seq_len
+ *   @pre 5 <= seq_len <= 8; or seq_len == 4 and seq_div.Next() never returns true
+ *   @pre If SIMD sorting networks are available, seq_len <= MaxLeafLen<Iterator, Compare>() is enough
+ * @param seq_div
+ * @param comp
+ */
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void SortLeaves(Iterator data, diff_t<Iterator> seq_len,
+                                         SequenceDivider<diff_t<Iterator>> seq_div, Compare comp) {
+    if constexpr (kHasSimdLeaves<Iterator, Compare>) {
+        if (!IsConstantEvaluated()) {
+            using T = std::remove_cv_t<typename std::iterator_traits<Iterator>::value_type>;
+            constexpr bool descending = kBuiltinOrder<Compare, T> < 0;
+            T* ptr = std::addressof(*data);
+            switch (SimdLeafIsa<T>()) {
+                case SimdIsa::kAvx512:
+                    return SimdSortLeavesFor<SimdIsa::kAvx512, descending>(ptr, seq_len, seq_div);
+                case SimdIsa::kAvx2:
+                    return SimdSortLeavesFor<SimdIsa::kAvx2, descending>(ptr, seq_len, seq_div);
+                case SimdIsa::kSse41:
+                    return SimdSortLeavesFor<SimdIsa::kSse41, descending>(ptr, seq_len, seq_div);
+                case SimdIsa::kNone:
+                    break;
+            }
+        }
+    }
+
+    do {
+        bool decr = seq_div.Next();
+        diff_t<Iterator> len = seq_len - decr;
+        switch (len) {
+            case 4:
+                OddEvenSort<4>(data, comp);
+                break;
+            case 5:
+                OddEvenSort<5>(data, comp);
+                break;
+            case 6:
+                OddEvenSort<6>(data, comp);
+                break;
+            case 7:
+                OddEvenSort<7>(data, comp);
+                break;
+            case 8:
+                OddEvenSort<8>(data, comp);
+                break;
+            default:
+#if __GNUC__
+                __builtin_unreachable();
+#endif
+                break;
+        };
+        data += len;
+    } while (!seq_div.IsEnd());
+}
+
+/**
+ * @brief Sort data with its length 0 to 8. Sorting is stable.
+ *
+ * @param data
+ * @param len
+ *   @pre 0 <= len <= 8
+ * @param comp
+ */
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void Sort0To8(Iterator data, diff_t<Iterator> len, Compare comp) {
+    if (len <= 1) {
+        return;
+    }
+    if (len <= 3) {
+        if (comp(data[1], data[0])) {
+            swap(data[0], data[1]);
+        }
+        if (len == 2) {
+            return;
+        }
+        if (comp(data[2], data[1])) {
+            swap(data[1], data[2]);
+        }
+        if (comp(data[1], data[0])) {
+            swap(data[0], data[1]);
+        }
+        return;
+    }
+    return SortLeaves(data, len, {len, diff_t<Iterator>{0}}, comp);
+}
+
+constexpr int kCiuraGaps[8] = {1, 4, 10, 23, 57, 132, 301, 701};
+
+/**
+ * @brief Find the larget gap within `len` from Ciura's gap sequence.
+ *
+ * @param len
+ *   @pre len >= 2
+ * @return gap
+ *   @post 1 <= gap < len
+ * @return n
+ *   @post n >= 0
+ *   @post NthShellSortGap(n) == gap
+ */
+template <typename SsizeT>
+constexpr std::pair<SsizeT, SsizeT> FirstShellSortGap(SsizeT len) {
+    SsizeT n = 4 * (kCiuraGaps[4] < len);
+    n += 2 * (kCiuraGaps[n + 2] < len);
+    n += kCiuraGaps[n + 1] < len;
+    SsizeT gap = kCiuraGaps[n];
+    if (n == 7) {
+        // floor(2.25 * gap) < len
+        while (gap < (len - gap / 4 + 1) / 2) {
+            gap = gap * 2 + gap / 4;
+            ++n;
+        }
+    }
+    return {gap, n};
+}
+
+/**
+ * @brief Find the n'th gap from Ciura's gap sequence.
+ *
+ * @param n
+ *   @pre n >= 0
+ * @return gap
+ *   @post gap >= 1
+ */
+template <typename SsizeT>
+constexpr SsizeT NthShellSortGap(SsizeT n) {
+    if (n < 8) {
+        return kCiuraGaps[n];
+    }
+    SsizeT i = 7;
+    SsizeT gap = kCiuraGaps[i];
+    do {
+        gap = gap * 2 + gap / 4;
+    } while (++i < n);
+    return gap;
+}
+
+/**
+ * @brief Sort data by Shell sorting with Ciura's gap sequence. Sorting is unstable.
+ *
+ * The sequence is extended by repeatedly applying `x \mapsto ceil(2.25 * x)` to the last pre-computed element 701.
+ * https://en.wikipedia.org/wiki/Shellsort#Computational_complexity
+ *
+ * Though we also considered Tokuda's sequence, this is abandoned since computing the sequence without floating-number
+ * is prone to overflow.
+ *
+ * @param data
+ * @param len
+ *   @pre len >= 2
+ * @param comp
+ */
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void ShellSort(Iterator data, diff_t<Iterator> len, Compare comp) {
+    auto [gap, n] = FirstShellSortGap(len);
+
+    while (true) {
+        diff_t<Iterator> i = gap;
+        do {
+            for (diff_t<Iterator> j = i; j >= gap; j -= gap) {
+                if (!comp(data[j], data[j - gap])) {
+                    break;
+                }
+                swap(data[j - gap], data[j]);
+            }
+        } while (++i < len);
+        if (!n) {
+            break;
+        }
+        gap = NthShellSortGap(--n);
+    }
+}
+
+//
+// Full sorting
+//
+
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP diff_t<Iterator> CollectKeys(Iterator first, Iterator last, diff_t<Iterator> num_desired_keys,
+                                                      Compare comp) {
+    if (first == last) {
+        return 0;
+    }
+    if (num_desired_keys <= 1) {
+        return num_desired_keys;
+    }
+
+    Iterator keys = first;
+    Iterator keys_last = first + 1;
+
+    for (Iterator cur = keys_last; cur < last; ++cur) {
+        Iterator inspos = BinarySearch<false>(keys, keys_last, cur, comp);
+        if (inspos == keys_last || comp(*cur, *inspos)) {
+            // Rotate keys forward so that insertion works in O(num_keys)
+            CountRotation(comp, keys, cur);
+            Rotate(keys, keys_last, cur);
+            keys += cur - keys_last;
+            inspos += cur - keys_last;
+            keys_last = cur;
+            // Insert the new key
+            CountRotation(comp, inspos, cur + 1);
+            Rotate(inspos, keys_last, cur + 1);
+            if (++keys_last - keys == num_desired_keys) {
+                break;
+            }
+        }
+    }
+
+    CountRotation(comp, first, keys_last);
+    Rotate(first, keys, keys_last);
+    return keys_last - keys;
+}
+
+//! Maximum number of distinct keys, with which data is sorted by `SortFewUnique`
+constexpr int kMaxFewUniqueKeys = 128;
+//! Length of leaves sorted by `CountingSortFewUnique`
+constexpr int kFewUniqueLeafLen = 512;
+
+/**
+ * @brief Merge adjacent sequences xs and ys, whose elements are equivalent to either of the given keys.
+ *
+ * The set of keys is recursively bisected by its median. Each step finds where the median splits xs and ys, and
+ * rotates the upper part of xs with the lower part of ys. So it takes O(log(k) * (m + n)) swaps and
+ * O(k * log(m + n)) comparisons, where `k` is the number of keys.
+ *
+ * @param xs
+ * @param ys
+ * @param ys_last
+ * @param keys
+ *   @pre [keys, keys_last) is strictly ascending, and disjoint with [xs, ys_last)
+ *   @pre For any x in [xs, ys_last), x is equivalent to one of [keys, keys_last)
+ * @param keys_last
+ * @param comp
+ */
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void MergeFewUnique(Iterator xs, Iterator ys, Iterator ys_last, Iterator keys,
+                                             Iterator keys_last, Compare comp) {
+    while (xs != ys && ys != ys_last && keys_last - keys >= 2 && comp(*ys, *(ys - 1))) {
+        Iterator pivot = keys + (keys_last - keys) / 2;
+        Iterator xs_upper = BinarySearch<false>(xs, ys, pivot, comp);
+        Iterator ys_upper = BinarySearch<false>(ys, ys_last, pivot, comp);
+        CountRotation(comp, xs_upper, ys_upper);
+        Rotate(xs_upper, ys, ys_upper);
+        Iterator mid = xs_upper + (ys_upper - ys);
+
+        // Recursion depth is at most log2(k), since keys are halved
+        MergeFewUnique(xs, xs_upper, mid, keys, pivot, comp);
+        xs = mid;
+        ys = mid + (ys - xs_upper);
+        keys = pivot;
+    }
+}
+
+/**
+ * @brief Sort a short sequence whose elements are equivalent to either of few keys, by counting sort.
+ *
+ * Each element is classified by binary search over keys, and then moved to its destination by cycle-following swaps.
+ * So it takes O(len * log(k)) comparisons and O(len) swaps.
+ *
+ * @param data
+ * @param len
+ *   @pre len <= kFewUniqueLeafLen
+ * @param keys
+ *   @pre [keys, keys_last) is strictly ascending, and disjoint with [data, data + len)
+ *   @pre keys_last - keys <= kMaxFewUniqueKeys
+ *   @pre For any x in [data, data + len), x is equivalent to one of [keys, keys_last)
+ * @param keys_last
+ * @param comp
+ */
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void CountingSortFewUnique(Iterator data, diff_t<Iterator> len, Iterator keys,
+                                                    Iterator keys_last, Compare comp) {
+    unsigned char classes[kFewUniqueLeafLen]{};
+    unsigned short dest[kFewUniqueLeafLen]{};
+    unsigned short offsets[kMaxFewUniqueKeys + 1]{};
+
+    BatchSearch<false>(keys, keys_last, data, len, classes, comp);
+    for (diff_t<Iterator> i = 0; i < len; ++i) {
+        ++offsets[classes[i] + 1];
+    }
+    for (int c = 0; c < kMaxFewUniqueKeys; ++c) {
+        offsets[c + 1] += offsets[c];
+    }
+    for (diff_t<Iterator> i = 0; i < len; ++i) {
+        dest[i] = offsets[classes[i]]++;
+    }
+
+    for (diff_t<Iterator> i = 0; i < len; ++i) {
+        while (dest[i] != i) {
+            unsigned short j = dest[i];
+            swap(data[i], data[j]);
+            dest[i] = dest[j];
+            dest[j] = j;
+        }
+    }
+}
+
+/**
+ * @brief Sort data whose elements are equivalent to either of few keys.
+ *
+ * Leaves are sorted by `CountingSortFewUnique`, then merged bottom-up by `MergeFewUnique`. Unlike the general path,
+ * no block merge is involved, and only O(n * log(k)) comparisons are required.
+ *
+ * @param keys
+ *   @pre [keys, data) is strictly ascending, and contains all unique keys in [keys, last)
+ *   @pre data - keys <= kMaxFewUniqueKeys
+ * @param data
+ * @param last
+ *   @pre data < last
+ * @param comp
+ */
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void SortFewUnique(Iterator keys, Iterator data, Iterator last, Compare comp) {
+    diff_t<Iterator> data_len = last - data;
+
+    for (Iterator leaf = data; leaf != last;) {
+        diff_t<Iterator> leaf_len = last - leaf < kFewUniqueLeafLen ? last - leaf : kFewUniqueLeafLen;
+        CountingSortFewUnique(leaf, leaf_len, keys, data, comp);
+        leaf += leaf_len;
+    }
+
+    for (diff_t<Iterator> seq_len = kFewUniqueLeafLen; seq_len < data_len; seq_len *= 2) {
+        Iterator xs = data;
+        while (last - xs > seq_len) {
+            Iterator ys = xs + seq_len;
+            Iterator ys_last = last - ys > seq_len ? ys + seq_len : last;
+            MergeFewUnique(xs, ys, ys_last, keys, data, comp);
+            xs = ys_last;
+        }
+    }
+
+    MergeWithoutBuf<false, SearchKind::kHwangLin>(keys, data, last, comp);
+}
+
+template <typename SsizeT>
+struct MergeSortControl {
+    /**
+     * @param num_keys
+     *   @pre num_keys == 0 or num_keys >= 8
+     * @param data_len
+     *   @pre data_len > 8
+     * @param max_seq_len
+     *   @pre max_seq_len is 8, 16, or 32
+     * @post 5 <= this->seq_len <= max_seq_len
+     * @post this->seq_len <= 8, unless max_seq_len > 8
+     */
+    constexpr MergeSortControl(SsizeT num_keys, SsizeT data_len, SsizeT max_seq_len = 8) : data_len{data_len} {
+        if (num_keys) {
+            // imit_len >= 2
+            imit_len = (num_keys + 2) / 4 * 2 - 2;
+            // buf_len >= 6
+            buf_len = num_keys - imit_len;
+            // bufferable_len >= 12
+            bufferable_len = (imit_len + 2) / 2 * buf_len;
+
+            // Leaves longer than 8 are allowed only if they are bufferable
+            while (max_seq_len > 8 && max_seq_len > bufferable_len) {
+                max_seq_len /= 2;
+            }
+        }
+
+        while ((data_len - 1) >> log2_num_seqs >= max_seq_len) {
+            ++log2_num_seqs;
+        }
+        // seq_len <= max(8, bufferable_len), so seq_len <= bufferable_len holds if num_keys != 0
+        seq_len = ((data_len - 1) >> log2_num_seqs) + 1;
+    }
+
+    /**
+     * @param buf_moved
+     *   Whether the last level moved the buffer to the opposite side. It's false if an external buffer is used.
+     * @return Length of the buffer if it's dropped at this point; otherwise 0.
+     */
+    constexpr SsizeT Next(bool buf_moved = true) {
+        --log2_num_seqs;
+        seq_len = ((data_len - 1) >> log2_num_seqs) + 1;
+
+        if (!buf_len) {
+            return 0;
+        }
+        forward = forward != buf_moved;
+
+        if (!log2_num_seqs || seq_len > bufferable_len) {
+            SsizeT old_buf_len = buf_len;
+            imit_len += buf_len;
+            buf_len = 0;
+            return old_buf_len;
+        }
+        return 0;
+    }
+
+    /**
+     * imit_len is positive and multiple of 2.
+     * imit_len + buf_len = num_keys.
+     */
+    SsizeT imit_len = 0;
+    /**
+     * buf_len is non-negative.
+     * If buf_len > 0
+     *   - seq_len <= bufferable_len
+     *   - imit_len + 2 <= buf_len
+     */
+    SsizeT buf_len = 0;
+    //! bufferable_len = ((imit_len + 2) / 2) * buf_len
+    SsizeT bufferable_len = 0;
+    //! data_len > 8
+    SsizeT data_len;
+
+    SsizeT log2_num_seqs = 1;
+    SsizeT seq_len{};
+    bool forward = true;
+};
+
+template <typename SsizeT>
+constexpr BlockingParam<SsizeT> DetermineBlocking(const MergeSortControl<SsizeT>& ctrl) {
+    SsizeT num_blocks = ctrl.imit_len + 2;
+    SsizeT seq_len = ctrl.seq_len;
+
+    if (ctrl.buf_len) {
+        // We don't need to perform runtime-checking so that computed `num_blocks` fits in imitation buffer.
+        // Since
+        //   seq_len <= (imit_len + 2) / 2 * buf_len
+        // is assured,
+        //   ceil(seq_len / buf_len) * 2 <= imit_len + 2
+        // always holds.
+        num_blocks = ((seq_len - 1) / ctrl.buf_len + 1) * 2;
+    } else {
+        // max_num_blocks must be a multple of 2 and under-approx of sqrt(2 * seq_len)
+        SsizeT max_num_blocks = seq_len < 12 ? 2 : seq_len / OverApproxSqrt(seq_len * 2) * 2;
+        if (num_blocks > max_num_blocks) {
+            num_blocks = max_num_blocks;
+        }
+    }
+
+    // We need to proof `residual_len >= 2` to assure that all blocks have positive length.
+    // (Note that `residual_len` may be decremented once in `MergeOneLevel`.)
+    // {{{ Proof
+    // We first show the following lemma. Let `N` and `m` be positive integers, such that
+    // `N >= m ** 2`, `N >= 2` and `m >= 1`.
+    //
+    //   (lemma):  N - ceil(N / m) * (m - 1) >= 2 .
+    //
+    // There are three cases.
+    //
+    //   (1):  m = 1 .
+    //   (2):  N = m ** 2, and m >= 2 .
+    //   (3):  N >= (m ** 2) + 1, and m >= 2 .
+    //
+    // If case (1) and (2), it's trivial to check that (lemma) holds.
+    // For case (3), we can use the following property:
+    //
+    //   ceil(N / m) <= (N / m) + ((m - 1) / m) .
+    //
+    // By multiplying `m - 1` to left and right hand sides, we have
+    //
+    //   ceil(N / m) * (m - 1) <= N + (m - 1) - ceil(N / m) .
+    //
+    // Since `N >= (m ** 2) + 1` from (3), `ceil(N / m) >= m + 1` holds. Therefore
+    //
+    //   ceil(N / m) * (m - 1) <= N + (m - 1) - (m + 1)
+    //                         =  N - 2 ,
+    //
+    // which is equivalent to (lemma). Thus the lemma is proven.
+    //
+    // Now it's enough to show that
+    //
+    //   (proposition):  seq_len >= (num_blocks / 2) ** 2 ,
+    //   (*):            seq_len >= 2 , and
+    //   (**):           num_blocks / 2 >= 1 .
+    //
+    // Note that (*) and (**) are immediate from the function's requirement.
+    //
+    // When `buf_len = 0`, the definition of `max_num_blocks` ensures that (proposition) is satisfied.
+    // For the case `buf_len > 0`, we use the following constraints.
+    //
+    //   (a):  imit_len + 2 <= buf_len .                   (by MergeSortControll)
+    //   (b):  seq_len <= (imit_len + 2) / 2 * buf_len .   (by MergeSortControll)
+    //   (c):  num_blocks / 2 = ceil(seq_len / buf_len) .  (by definition)
+    //
+    // From (a) and (b), we have `seq_len <= (buf_len ** 2) / 2`. Therefore
+    //
+    //   (d):  buf_len >= sqrt(2) * sqrt(seq_len)
+    //
+    // holds. Using (c) and (d), we have
+    //
+    //   (e):  num_blocks / 2 <= ceil(sqrt(seq_len) / sqrt(2)) .
+    //                        <= (sqrt(seq_len) / sqrt(2)) + 1
+    //
+    // Thanks to (e), it's easy to show that the following (subprop) is enough to prove (proposition).
+    //
+    //   (subprop):  sqrt(seq_len) >= (sqrt(seq_len) / sqrt(2)) + 1
+    //
+    // As the function requires `seq_len >= 8`, (subprop) is always satisfied. Thus (proposition) is true.
+    // Therefore We have proven `residual_len >= 2`.
+    // }}}
+
+    SsizeT block_len = (seq_len - 1) / (num_blocks / 2) + 1;
+    SsizeT residual_len = seq_len - block_len * (num_blocks / 2 - 1);
+
+    return {num_blocks, block_len, residual_len, residual_len};
+}
+
+/**
+ * @brief Phase listener of `Sort`, which ignores everything.
+ */
+struct NullPhaseListener {
+    constexpr void on_phase_begin(sort_phase, const sort_phase_info&) {}
+    constexpr void on_phase_end(sort_phase) {}
+};
+
+template <typename Listener, typename = void>
+constexpr bool kIsPhaseListener = false;
+
+template <typename Listener>
+constexpr bool kIsPhaseListener<
+    Listener, std::void_t<decltype(std::declval<Listener&>().on_phase_begin(sort_phase{}, sort_phase_info{})),
+                          decltype(std::declval<Listener&>().on_phase_end(sort_phase{}))>> = true;
+
+template <typename SsizeT>
+constexpr sort_phase_info MergeLevelInfo(SsizeT data_len, SsizeT seq_len, const BlockingParam<SsizeT>* p,
+                                         bool buffered) {
+    return {static_cast<std::ptrdiff_t>(data_len), static_cast<std::ptrdiff_t>(seq_len),
+            static_cast<std::ptrdiff_t>(p ? p->num_blocks : 0), static_cast<std::ptrdiff_t>(p ? p->block_len : 0),
+            buffered};
+}
+
+/**
+ * @brief Sort data stably.
+ *
+ * @param first
+ * @param last
+ * @param comp
+ * @param ext_buf
+ * @param ext_buf_len
+ *   @pre ext_buf_len >= 0, and [ext_buf, ext_buf + ext_buf_len) doesn't overlap with [first, last)
+ * @param listener
+ *   Notified at the beginning and the end of each phase. Phases aren't nested.
+ */
+template <typename Iterator, typename Compare, typename BufIterator = Iterator,
+          typename Listener = NullPhaseListener>
+SAYHISORT_CONSTEXPR_SWAP void Sort(Iterator first, Iterator last, Compare comp, BufIterator ext_buf = BufIterator{},
+                                   diff_t<Iterator> ext_buf_len = 0, Listener&& listener = {}) {
+    diff_t<Iterator> len = last - first;
+    if (len <= 8) {
+        return Sort0To8(first, len, comp);
+    }
+
+    // If the external buffer is long enough to merge the top level, keys are unnecessary at all.
+    if (ext_buf_len >= len - len / 2) {
+        MergeSortControl ctrl{diff_t<Iterator>{0}, len, MaxLeafLen<Iterator, Compare>()};
+        listener.on_phase_begin(sort_phase::sort_leaves, {static_cast<std::ptrdiff_t>(len),
+                                                          static_cast<std::ptrdiff_t>(ctrl.seq_len)});
+        SortLeaves(first, ctrl.seq_len, {len, ctrl.log2_num_seqs}, comp);
+        listener.on_phase_end(sort_phase::sort_leaves);
+        CountStat(comp, &sort_stats::buffered_levels, static_cast<std::uint64_t>(ctrl.log2_num_seqs));
+
+        // If the external buffer is as long as the data, sequences are merged back and forth between them, so that
+        // merging needs no extra swaps and is done from both ends. With an odd number of levels, the first level is
+        // merged in-place instead, so that the data is back at the end.
+        bool ping_pong = ext_buf_len >= len;
+        bool in_place = !ping_pong || ctrl.log2_num_seqs % 2;
+        bool in_ext_buf = false;
+        do {
+            listener.on_phase_begin(sort_phase::merge_level,
+                                    MergeLevelInfo<diff_t<Iterator>>(len, ctrl.seq_len, nullptr, true));
+            if (in_place) {
+                MergeOneLevelWithExtBuf(first, ctrl.seq_len, {len, ctrl.log2_num_seqs}, ext_buf, comp);
+                in_place = !ping_pong;
+            } else if (!in_ext_buf) {
+                MergeOneLevelOutOfPlace(first, ctrl.seq_len, {len, ctrl.log2_num_seqs}, ext_buf, comp);
+                in_ext_buf = true;
+            } else {
+                MergeOneLevelOutOfPlace(ext_buf, ctrl.seq_len, {len, ctrl.log2_num_seqs}, first, comp);
+                in_ext_buf = false;
+            }
+            listener.on_phase_end(sort_phase::merge_level);
+            ctrl.Next();
+        } while (ctrl.log2_num_seqs);
+        return;
+    }
+
+    Iterator imit = first;
+    diff_t<Iterator> num_keys = 0;
+    if (len > 16) {
+        diff_t<Iterator> num_desired_keys = 2 * OverApproxSqrt(len) - 2;
+        listener.on_phase_begin(sort_phase::collect_keys, {static_cast<std::ptrdiff_t>(len)});
+        num_keys = CollectKeys(first, last, num_desired_keys, comp);
+        listener.on_phase_end(sort_phase::collect_keys);
+        CountStat(comp, &sort_stats::collected_keys, static_cast<std::uint64_t>(num_keys));
+        // If keys are insufficient, they are all the unique keys in data
+        if (num_keys < num_desired_keys && num_keys <= kMaxFewUniqueKeys) {
+            MergeSortControl ctrl{diff_t<Iterator>{0}, len, MaxLeafLen<Iterator, Compare>()};
+            CountStat(comp, &sort_stats::skipped_levels, static_cast<std::uint64_t>(ctrl.log2_num_seqs));
+            listener.on_phase_begin(sort_phase::sort_few_unique, {static_cast<std::ptrdiff_t>(len)});
+            SortFewUnique(first, first + num_keys, last, comp);
+            listener.on_phase_end(sort_phase::sort_few_unique);
+            return;
+        }
+        if (num_keys < 8) {
+            imit += num_keys;
+            len -= num_keys;
+            num_keys = 0;
+        }
+    }
+
+    // If len = 17, num_keys is at most 8; so data_len > 8
+    diff_t<Iterator> data_len = len - num_keys;
+    MergeSortControl ctrl{num_keys, data_len, MaxLeafLen<Iterator, Compare>()};
+
+    Iterator data = imit + num_keys;
+    listener.on_phase_begin(sort_phase::sort_leaves, {static_cast<std::ptrdiff_t>(data_len),
+                                                      static_cast<std::ptrdiff_t>(ctrl.seq_len)});
+    SortLeaves(data, ctrl.seq_len, {ctrl.data_len, ctrl.log2_num_seqs}, comp);
+    listener.on_phase_end(sort_phase::sort_leaves);
+
+    do {
+        // Lower levels are merged by the external buffer as long as it's long enough.
+        // The internal buffer stays before data in the meantime.
+        bool use_ext_buf = ctrl.seq_len <= ext_buf_len;
+        BlockingParam p = DetermineBlocking(ctrl);
+        CountStat(comp, use_ext_buf || ctrl.buf_len ? &sort_stats::buffered_levels : &sort_stats::unbuffered_levels);
+        listener.on_phase_begin(sort_phase::merge_level,
+                                MergeLevelInfo(data_len, ctrl.seq_len, use_ext_buf ? nullptr : &p,
+                                               use_ext_buf || ctrl.buf_len));
+
+        if (use_ext_buf) {
+            MergeOneLevelWithExtBuf(data, ctrl.seq_len, {ctrl.data_len, ctrl.log2_num_seqs}, ext_buf, comp);
+        } else if (!ctrl.buf_len) {
+            MergeOneLevel<false, true>(imit, imit + ctrl.imit_len, data, ctrl.seq_len,
+                                       {ctrl.data_len, ctrl.log2_num_seqs}, p, comp);
+        } else if (ctrl.forward) {
+            MergeOneLevel<true, true>(imit, imit + ctrl.imit_len, data, ctrl.seq_len,
+                                      {ctrl.data_len, ctrl.log2_num_seqs}, p, comp);
+        } else {
+            MergeOneLevel<true, false>(imit, last, last - ctrl.buf_len, ctrl.seq_len,
+                                       {ctrl.data_len, ctrl.log2_num_seqs}, p, comp);
+        }
+        listener.on_phase_end(sort_phase::merge_level);
+
+        if (diff_t<Iterator> old_buf_len = ctrl.Next(!use_ext_buf)) {
+            listener.on_phase_begin(sort_phase::redistribute_buffer, {static_cast<std::ptrdiff_t>(data - imit)});
+            Iterator buf = data - old_buf_len;
+            if (!ctrl.forward) {
+                CountSwaps(comp, last - data);
+                SwapRangesBackward(last - old_buf_len, last, last - data);
+                ctrl.forward = true;
+            }
+            ShellSort(buf, old_buf_len, comp);
+            if (data - imit <= ext_buf_len) {
+                MergeWithExtBuf(imit, buf, data, ext_buf, comp);
+            } else {
+                MergeWithoutBuf<false, SearchKind::kHwangLin>(imit, buf, data, comp);
+            }
+            listener.on_phase_end(sort_phase::redistribute_buffer);
+        }
+    } while (ctrl.log2_num_seqs);
+
+    if (first != data) {
+        listener.on_phase_begin(sort_phase::merge_keys, {static_cast<std::ptrdiff_t>(last - first)});
+        if (data - first <= ext_buf_len) {
+            MergeWithExtBuf(first, data, last, ext_buf, comp);
+        } else {
+            MergeWithoutBuf<false, SearchKind::kHwangLin>(first, data, last, comp);
+        }
+        listener.on_phase_end(sort_phase::merge_keys);
+    }
+}
+
+//
+// SIMD partitioning
+//
+
+/**
+ * @brief SIMD operations for partitioning, specialized for each instruction set and element type.
+ *
+ * A specialization provides the following members, all of which are compiled for the instruction set:
+ *   - `Reg`: register type holding `kLanes` elements
+ *   - `Fill(v, x)`: broadcast `x` to all lanes of `v`
+ *   - `Load(v, p)`, `Store(p, v)`: load or store `kLanes` elements
+ *   - `MaskLess(v, k)`, `MaskGreater(v, k)`: bit mask of lanes of `v` less or greater than the same lanes of `k`
+ *   - `Partition(v, mask, num_left)`: move lanes in `mask`, of which there are `num_left`, to the front of `v` and
+ *     the others to the back
+ */
+template <SimdIsa isa, typename T, std::size_t = sizeof(T)>
+struct SimdPartitionOps {
+    static constexpr bool kAvailable = false;
+};
+
+#if SAYHISORT_RUNTIME_DISPATCH || defined(__AVX512F__)
+
+template <typename T>
+struct SimdPartitionOps<SimdIsa::kAvx512, T, 4> {
+    static constexpr bool kAvailable = true;
+    static constexpr int kLanes = 16;
+    using Reg = __m512i;
+
+    SAYHISORT_TARGET("avx512f") static void Fill(Reg& v, T x) { v = _mm512_set1_epi32(static_cast<int>(x)); }
+
+    SAYHISORT_TARGET("avx512f") static void Load(Reg& v, const T* p) { v = _mm512_loadu_si512(p); }
+
+    SAYHISORT_TARGET("avx512f") static void Store(T* p, const Reg& v) { _mm512_storeu_si512(p, v); }
+
+    SAYHISORT_TARGET("avx512f") static unsigned MaskLess(const Reg& v, const Reg& k) {
+        if constexpr (std::is_signed_v<T>) {
+            return _mm512_cmplt_epi32_mask(v, k);
+        } else {
+            return _mm512_cmplt_epu32_mask(v, k);
+        }
+    }
+
+    SAYHISORT_TARGET("avx512f") static unsigned MaskGreater(const Reg& v, const Reg& k) {
+        if constexpr (std::is_signed_v<T>) {
+            return _mm512_cmpgt_epi32_mask(v, k);
+        } else {
+            return _mm512_cmpgt_epu32_mask(v, k);
+        }
+    }
+
+    // Compressions in registers; compressing stores are far slower on some CPUs
+    SAYHISORT_TARGET("avx512f") static void Partition(Reg& v, unsigned mask, int num_left) {
+        auto left = static_cast<__mmask16>(mask);
+        auto back = static_cast<__mmask16>(~((1u << num_left) - 1));
+        v = _mm512_mask_expand_epi32(_mm512_maskz_compress_epi32(left, v), back,
+                                     _mm512_maskz_compress_epi32(static_cast<__mmask16>(~left), v));
+    }
+};
+
+template <typename T>
+struct SimdPartitionOps<SimdIsa::kAvx512, T, 8> {
+    static constexpr bool kAvailable = true;
+    static constexpr int kLanes = 8;
+    using Reg = __m512i;
+
+    SAYHISORT_TARGET("avx512f") static void Fill(Reg& v, T x) { v = _mm512_set1_epi64(static_cast<long long>(x)); }
+
+    SAYHISORT_TARGET("avx512f") static void Load(Reg& v, const T* p) { v = _mm512_loadu_si512(p); }
+
+    SAYHISORT_TARGET("avx512f") static void Store(T* p, const Reg& v) { _mm512_storeu_si512(p, v); }
+
+    SAYHISORT_TARGET("avx512f") static unsigned MaskLess(const Reg& v, const Reg& k) {
+        if constexpr (std::is_signed_v<T>) {
+            return _mm512_cmplt_epi64_mask(v, k);
+        } else {
+            return _mm512_cmplt_epu64_mask(v, k);
+        }
+    }
+
+    SAYHISORT_TARGET("avx512f") static unsigned MaskGreater(const Reg& v, const Reg& k) {
+        if constexpr (std::is_signed_v<T>) {
+            return _mm512_cmpgt_epi64_mask(v, k);
+        } else {
+            return _mm512_cmpgt_epu64_mask(v, k);
+        }
+    }
+
+    SAYHISORT_TARGET("avx512f") static void Partition(Reg& v, unsigned mask, int num_left) {
+        auto left = static_cast<__mmask8>(mask);
+        auto back = static_cast<__mmask8>(~((1u << num_left) - 1));
+        v = _mm512_mask_expand_epi64(_mm512_maskz_compress_epi64(left, v), back,
+                                     _mm512_maskz_compress_epi64(static_cast<__mmask8>(~left), v));
+    }
+};
+
+#endif
+
+#if SAYHISORT_RUNTIME_DISPATCH || defined(__AVX2__)
+
+/**
+ * @brief Permutations of 8 32-bit words moving the words of lanes in each mask to the front, indexed by the mask.
+ *
+ * Each permutation packs the source index of the i-th word into the i-th nibble.
+ *
+ * @tparam lanes Number of lanes, each of which consists of `8 / lanes` words
+ */
+template <int lanes>
+struct PartitionPermutations {
+    constexpr PartitionPermutations() {
+        constexpr int words = 8 / lanes;
+        for (unsigned mask = 0; mask < (1u << lanes); ++mask) {
+            int pos = 0;
+            for (int side = 1; side >= 0; --side) {
+                for (int lane = 0; lane < lanes; ++lane) {
+                    if (static_cast<int>((mask >> lane) & 1u) == side) {
+                        for (int w = 0; w < words; ++w) {
+                            indices[mask] |= static_cast<std::uint32_t>(lane * words + w) << (pos++ * 4);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::uint32_t indices[1u << lanes]{};
+};
+
+// AVX2 lacks unsigned comparison, so sign bits are flipped for unsigned types
+template <typename T>
+struct SimdPartitionOps<SimdIsa::kAvx2, T, 4> {
+    static constexpr bool kAvailable = true;
+    static constexpr int kLanes = 8;
+    using Reg = __m256i;
+    static constexpr PartitionPermutations<kLanes> kPermutations{};
+
+    SAYHISORT_TARGET("avx2") static void Fill(Reg& v, T x) {
+        v = _mm256_set1_epi32(static_cast<int>(x));
+        if constexpr (std::is_unsigned_v<T>) {
+            v = _mm256_xor_si256(v, _mm256_set1_epi32(std::numeric_limits<int>::min()));
+        }
+    }
+
+    SAYHISORT_TARGET("avx2") static void Load(Reg& v, const T* p) {
+        v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+
+    SAYHISORT_TARGET("avx2") static void Store(T* p, const Reg& v) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+    }
+
+    SAYHISORT_TARGET("avx2") static unsigned MaskLess(const Reg& v, const Reg& k) {
+        return static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, Signed(v)))));
+    }
+
+    SAYHISORT_TARGET("avx2") static unsigned MaskGreater(const Reg& v, const Reg& k) {
+        return static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(Signed(v), k))));
+    }
+
+    SAYHISORT_TARGET("avx2") static void Partition(Reg& v, unsigned mask, int) {
+        __m256i shifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+        __m256i indices = _mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(kPermutations.indices[mask])), shifts);
+        v = _mm256_permutevar8x32_epi32(v, indices);
+    }
+
+    // Lanes to compare with `Fill`ed ones; loaded ones are kept intact to be stored
+    SAYHISORT_TARGET("avx2") static Reg Signed(const Reg& v) {
+        if constexpr (std::is_unsigned_v<T>) {
+            return _mm256_xor_si256(v, _mm256_set1_epi32(std::numeric_limits<int>::min()));
+        } else {
+            return v;
+        }
+    }
+};
+
+template <typename T>
+struct SimdPartitionOps<SimdIsa::kAvx2, T, 8> {
+    static constexpr bool kAvailable = true;
+    static constexpr int kLanes = 4;
+    using Reg = __m256i;
+    static constexpr PartitionPermutations<kLanes> kPermutations{};
+
+    SAYHISORT_TARGET("avx2") static void Fill(Reg& v, T x) {
+        v = _mm256_set1_epi64x(static_cast<long long>(x));
+        if constexpr (std::is_unsigned_v<T>) {
+            v = _mm256_xor_si256(v, _mm256_set1_epi64x(std::numeric_limits<long long>::min()));
+        }
+    }
+
+    SAYHISORT_TARGET("avx2") static void Load(Reg& v, const T* p) {
+        v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+
+    SAYHISORT_TARGET("avx2") static void Store(T* p, const Reg& v) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+    }
+
+    SAYHISORT_TARGET("avx2") static unsigned MaskLess(const Reg& v, const Reg& k) {
+        return static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(k, Signed(v)))));
+    }
+
+    SAYHISORT_TARGET("avx2") static unsigned MaskGreater(const Reg& v, const Reg& k) {
+        return static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(Signed(v), k))));
+    }
+
+    SAYHISORT_TARGET("avx2") static void Partition(Reg& v, unsigned mask, int) {
+        __m256i shifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+        __m256i indices = _mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(kPermutations.indices[mask])), shifts);
+        v = _mm256_permutevar8x32_epi32(v, indices);
+    }
+
+    SAYHISORT_TARGET("avx2") static Reg Signed(const Reg& v) {
+        if constexpr (std::is_unsigned_v<T>) {
+            return _mm256_xor_si256(v, _mm256_set1_epi64x(std::numeric_limits<long long>::min()));
+        } else {
+            return v;
+        }
+    }
+};
+
+#endif
+
+/**
+ * @brief Entry points of `SimdPartition` compiled for each instruction set, into which the whole kernel is inlined.
+ */
+template <SimdIsa isa>
+struct SimdPartitionKernel;
+
+#if SAYHISORT_HAS_SIMD_LEAVES
+
+/**
+ * @brief Bit mask of lanes of `v` partitioned to the left by `PartitionBranchless`.
+ */
+template <typename Ops, bool left_equal, bool descending, typename Reg>
+inline unsigned LeftMask(const Reg& v, const Reg& pivots) {
+    constexpr unsigned all = (1u << Ops::kLanes) - 1;
+    if constexpr (descending) {
+        return left_equal ? ~Ops::MaskLess(v, pivots) & all : Ops::MaskGreater(v, pivots);
+    } else {
+        return left_equal ? ~Ops::MaskGreater(v, pivots) & all : Ops::MaskLess(v, pivots);
+    }
+}
+
+/**
+ * @brief `PartitionBranchless` of `[first, first + len)` by SIMD comparisons and permutations, `kLanes` elements at
+ * a time.
+ *
+ * The first and last `kLanes` elements are put aside in registers, which leaves room for `kLanes` elements at both
+ * ends. Then each vector is read from the end with less room, and permuted so that it can be stored to both ends at
+ * once, in which the left and the right elements land respectively. Elements remaining in the middle and put aside
+ * are partitioned one by one at last.
+ *
+ * @param first
+ * @param len
+ *   @pre len >= 2 * Ops::kLanes
+ * @param pivot
+ * @param comp
+ * @return boundary - first
+ */
+template <typename Ops, bool left_equal, typename T, typename SsizeT, typename Compare>
+SsizeT SimdPartition(T* first, SsizeT len, T pivot, Compare comp) {
+    constexpr int kLanes = Ops::kLanes;
+    constexpr bool descending = kBuiltinOrder<Compare, T> < 0;
+
+    typename Ops::Reg pivots, head, tail, v;
+    Ops::Fill(pivots, pivot);
+    Ops::Load(head, first);
+    Ops::Load(tail, first + len - kLanes);
+
+    T* read_left = first + kLanes;
+    T* read_right = first + len - kLanes;
+    T* write_left = first;
+    T* write_right = first + len;
+    // Room at both ends sums up to 2 * kLanes, so the end read from has room for `kLanes` elements after the read,
+    // and the other end has had it before.
+    while (read_right - read_left >= kLanes) {
+        if (read_left - write_left <= write_right - read_right) {
+            Ops::Load(v, read_left);
+            read_left += kLanes;
+        } else {
+            read_right -= kLanes;
+            Ops::Load(v, read_right);
+        }
+        unsigned mask = LeftMask<Ops, left_equal, descending>(v, pivots);
+        int num_left = PopCount(mask);
+        Ops::Partition(v, mask, num_left);
+        Ops::Store(write_left, v);
+        Ops::Store(write_right - kLanes, v);
+        write_left += num_left;
+        write_right -= kLanes - num_left;
+    }
+
+    T rest[3 * kLanes];
+    Ops::Store(rest, head);
+    Ops::Store(rest + kLanes, tail);
+    int num_rest = 2 * kLanes + static_cast<int>(read_right - read_left);
+    std::copy(read_left, read_right, rest + 2 * kLanes);
+    // Stored to both ends, one of which is taken
+    for (int i = 0; i < num_rest; ++i) {
+        bool goes_left = left_equal ? !comp(pivot, rest[i]) : comp(rest[i], pivot);
+        *write_left = rest[i];
+        write_right[-1] = rest[i];
+        write_left += goes_left;
+        write_right -= !goes_left;
+    }
+    return static_cast<SsizeT>(write_left - first);
+}
+
+template <>
+struct SimdPartitionKernel<SimdIsa::kAvx2> {
+    template <bool left_equal, typename T, typename SsizeT, typename Compare>
+    SAYHISORT_TARGET("avx2,popcnt") SAYHISORT_FLATTEN static SsizeT Run(T* first, SsizeT len, T pivot,
+                                                                        Compare comp) {
+        return SimdPartition<SimdPartitionOps<SimdIsa::kAvx2, T>, left_equal>(first, len, pivot, comp);
+    }
+};
+
+template <>
+struct SimdPartitionKernel<SimdIsa::kAvx512> {
+    template <bool left_equal, typename T, typename SsizeT, typename Compare>
+    SAYHISORT_TARGET("avx512f,popcnt") SAYHISORT_FLATTEN static SsizeT Run(T* first, SsizeT len, T pivot,
+                                                                           Compare comp) {
+        return SimdPartition<SimdPartitionOps<SimdIsa::kAvx512, T>, left_equal>(first, len, pivot, comp);
+    }
+};
+
+#endif
+
+/**
+ * @brief The most capable instruction set which has SIMD partitioning of `T` and is supported by the CPU.
+ */
+template <typename T>
+SimdIsa SimdPartitionIsa() {
+    SimdIsa cpu = CpuSimdIsa();
+    if (SimdPartitionOps<SimdIsa::kAvx512, T>::kAvailable && cpu >= SimdIsa::kAvx512) {
+        return SimdIsa::kAvx512;
+    }
+    if (SimdPartitionOps<SimdIsa::kAvx2, T>::kAvailable && cpu >= SimdIsa::kAvx2) {
+        return SimdIsa::kAvx2;
+    }
+    return SimdIsa::kNone;
+}
+
+/**
+ * @brief Whether sequences may be partitioned by SIMD comparisons, if the CPU supports an instruction set for them.
+ */
+template <typename Iterator, typename Compare,
+          typename T = std::remove_cv_t<typename std::iterator_traits<Iterator>::value_type>>
+constexpr bool kHasSimdPartition =
+    std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+    (SimdPartitionOps<SimdIsa::kAvx2, T>::kAvailable || SimdPartitionOps<SimdIsa::kAvx512, T>::kAvailable) &&
+    kBuiltinOrder<Compare, T> != 0 && kIsContiguousIterator<Iterator>;
+
+template <SimdIsa isa, bool left_equal, typename T, typename SsizeT, typename Compare>
+SsizeT SimdPartitionFor(T* first, SsizeT len, T pivot, Compare comp) {
+    if constexpr (SimdPartitionOps<isa, T>::kAvailable) {
+        if (len >= 2 * SimdPartitionOps<isa, T>::kLanes) {
+            return SimdPartitionKernel<isa>::template Run<left_equal>(first, len, pivot, comp);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief `SimdPartition` for the CPU.
+ *
+ * @return boundary - first; or -1 if the CPU supports no instruction set for it, or len is shorter than its two vectors
+ */
+template <bool left_equal, typename T, typename SsizeT, typename Compare>
+SsizeT DispatchSimdPartition(T* first, SsizeT len, T pivot, Compare comp) {
+    switch (SimdPartitionIsa<T>()) {
+        case SimdIsa::kAvx512:
+            return SimdPartitionFor<SimdIsa::kAvx512, left_equal>(first, len, pivot, comp);
+        case SimdIsa::kAvx2:
+            return SimdPartitionFor<SimdIsa::kAvx2, left_equal>(first, len, pivot, comp);
+        case SimdIsa::kSse41:
+        case SimdIsa::kNone:
+            break;
+    }
+    return -1;
+}
+
+//
+// Unstable sorting
+//
+
+/**
+ * @brief Whether sorting values of `Iterator` by `Compare` can't tell a stable algorithm from an unstable one.
+ *
+ * It's the case for integers compared by builtin operators, since equivalent integers are identical. Floating-point
+ * numbers are excluded, as -0.0 and +0.0 are equivalent but distinguishable.
+ */
+template <typename Iterator, typename Compare,
+          typename T = std::remove_cv_t<typename std::iterator_traits<Iterator>::value_type>>
+constexpr bool kIsStabilityUnobservable = std::is_integral_v<T> && kBuiltinOrder<Compare, T> != 0;
+
+// Observation shouldn't change code paths
+template <typename Iterator, typename Compare, typename T>
+constexpr bool kIsStabilityUnobservable<Iterator, ObservedCompare<Compare>, T> =
+    kIsStabilityUnobservable<Iterator, Compare, T>;
+
+//! Sequences longer than this are partitioned by the first, middle and last elements by `IntroSort`
+constexpr int kMinNintherLen = 128;
 
 /**
- * @brief Find the larget gap within `len` from Ciura's gap sequence.
+ * @brief Move the median of three elements to `*a`, and put the least and the greatest of them to `*b` and `*c`.
+ */
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void MoveMedianOf3(Iterator a, Iterator b, Iterator c, Compare comp) {
+    if (comp(*c, *b)) {
+        swap(*b, *c);
+    }
+    if (comp(*a, *b)) {
+        swap(*a, *b);
+    } else if (comp(*c, *a)) {
+        swap(*a, *c);
+    }
+}
+
+/**
+ * @brief Partition `[first + 1, last)` by the pivot `*first`, without branches depending on comparisons.
  *
- * @param len
- *   @pre len >= 2
- * @return gap
- *   @post 1 <= gap < len
- * @return n
- *   @post n >= 0
- *   @post NthShellSortGap(n) == gap
+ * Values are moved through a hole in the manner of Lomuto partitioning, and only the boundary is conditionally
+ * advanced. So it suits values cheap to copy, such as integers.
+ * Integers in contiguous memory compared by builtin operators are partitioned by `SimdPartition` instead.
+ *
+ * @tparam left_equal Whether elements equivalent to the pivot are partitioned to the left
+ * @param first
+ * @param last
+ *   @pre last - first >= 2
+ * @param comp
+ * @return Boundary: elements in `[first + 1, boundary)` are less than (or equivalent to, if `left_equal`) the pivot,
+ *   and the others aren't.
  */
-template <typename SsizeT>
-constexpr std::pair<SsizeT, SsizeT> FirstShellSortGap(SsizeT len) {
-    SsizeT n = 4 * (kCiuraGaps[4] < len);
-    n += 2 * (kCiuraGaps[n + 2] < len);
-    n += kCiuraGaps[n + 1] < len;
-    SsizeT gap = kCiuraGaps[n];
-    if (n == 7) {
-        // floor(2.25 * gap) < len
-        while (gap < (len - gap / 4 + 1) / 2) {
-            gap = gap * 2 + gap / 4;
-            ++n;
+template <bool left_equal, typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP Iterator PartitionBranchless(Iterator first, Iterator last, Compare comp) {
+    using T = typename std::iterator_traits<Iterator>::value_type;
+    T pivot = *first;
+    if constexpr (kHasSimdPartition<Iterator, Compare>) {
+        if (!IsConstantEvaluated()) {
+            diff_t<Iterator> boundary =
+                DispatchSimdPartition<left_equal>(std::addressof(first[1]), last - first - 1, pivot, comp);
+            if (boundary >= 0) {
+                return first + 1 + boundary;
+            }
         }
     }
-    return {gap, n};
+    auto goes_left = [&pivot, &comp](const T& x) {
+        if constexpr (left_equal) {
+            return !comp(pivot, x);
+        } else {
+            return comp(x, pivot);
+        }
+    };
+
+    Iterator left = first + 1;
+    T hole_value = *left;
+    Iterator right = left;
+    for (; right < last - 1; ++right) {
+        *right = *left;
+        *left = right[1];
+        left += goes_left(*left);
+    }
+    *right = *left;
+    *left = hole_value;
+    left += goes_left(hole_value);
+    return left;
 }
 
 /**
- * @brief Find the n'th gap from Ciura's gap sequence.
+ * @brief Sort data unstably by quick sort with branchless partitioning, falling back to `Sort` if recursion is deep.
  *
- * @param n
- *   @pre n >= 0
- * @return gap
- *   @post gap >= 1
+ * Short sequences are sorted as leaves of `Sort`, by SIMD sorting networks if available. If the pivot is equivalent
+ * to the element just before the sequence, which must be the previous pivot, all elements equivalent to it are
+ * partitioned out at once; so few distinct keys are sorted in O(N) per key.
+ *
+ * @param first
+ * @param last
+ * @param comp
+ * @param depth_limit Number of partitions allowed on the way from the root, until `Sort` takes over.
+ * @param leftmost Whether `[first, last)` is the leftmost sequence; otherwise `*(first - 1)` is a previous pivot.
+ * @pre kIsStabilityUnobservable<Iterator, Compare>
  */
-template <typename SsizeT>
-constexpr SsizeT NthShellSortGap(SsizeT n) {
-    if (n < 8) {
-        return kCiuraGaps[n];
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void IntroSort(Iterator first, Iterator last, Compare comp, int depth_limit,
+                                        bool leftmost = true) {
+    const diff_t<Iterator> max_leaf_len = MaxLeafLen<Iterator, Compare>();
+    while (last - first > max_leaf_len) {
+        if (!depth_limit--) {
+            return Sort(first, last, comp);
+        }
+        diff_t<Iterator> len = last - first;
+        Iterator mid = first + len / 2;
+        if (len > kMinNintherLen) {
+            MoveMedianOf3(first + 1, first + 2, last - 2, comp);
+            MoveMedianOf3(mid - 1, mid - 2, mid + 1, comp);
+            MoveMedianOf3(last - 1, last - 3, mid + 2, comp);
+            MoveMedianOf3(mid, first + 1, last - 1, comp);
+        }
+        MoveMedianOf3(mid, first, last - 1, comp);
+        swap(*first, *mid);
+
+        CountStat(comp, &sort_stats::partitions);
+        if (!leftmost && !comp(*(first - 1), *first)) {
+            first = PartitionBranchless<true>(first, last, comp);
+            continue;
+        }
+        Iterator boundary = PartitionBranchless<false>(first, last, comp);
+        Iterator pivot = boundary - 1;
+        swap(*first, *pivot);
+
+        // Recursion is limited to the shorter side, so that the stack is O(log(N))
+        if (pivot - first < last - boundary) {
+            IntroSort(first, pivot, comp, depth_limit, leftmost);
+            first = boundary;
+            leftmost = false;
+        } else {
+            IntroSort(boundary, last, comp, depth_limit, false);
+            last = pivot;
+        }
     }
-    SsizeT i = 7;
-    SsizeT gap = kCiuraGaps[i];
-    do {
-        gap = gap * 2 + gap / 4;
-    } while (++i < n);
-    return gap;
+
+    diff_t<Iterator> len = last - first;
+    if (len <= 8) {
+        return Sort0To8(first, len, comp);
+    }
+    return SortLeaves(first, len, {len, diff_t<Iterator>{0}}, comp);
 }
 
 /**
- * @brief Sort data by Shell sorting with Ciura's gap sequence. Sorting is unstable.
+ * @brief Sort data by `IntroSort`, with its depth limit of 2 log2(N).
+ */
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void UnstableSort(Iterator first, Iterator last, Compare comp) {
+    int depth_limit = 0;
+    for (diff_t<Iterator> len = last - first; len > 1; len /= 2) {
+        depth_limit += 2;
+    }
+    return IntroSort(first, last, comp, depth_limit);
+}
+
+/**
+ * @brief Sort data by `UnstableSort` if stability is unobservable, otherwise by `Sort`.
  *
- * The sequence is extended by repeatedly applying `x \mapsto ceil(2.25 * x)` to the last pre-computed element 701.
- * https://en.wikipedia.org/wiki/Shellsort#Computational_complexity
+ * @param listener
+ *   Notified of the phases of `Sort`, or of `UnstableSort` as a single `quick_sort` phase.
+ */
+template <typename Iterator, typename Compare, typename Listener = NullPhaseListener>
+SAYHISORT_CONSTEXPR_SWAP void DispatchSort(Iterator first, Iterator last, Compare comp, Listener&& listener = {}) {
+    if constexpr (kIsStabilityUnobservable<Iterator, Compare>) {
+        listener.on_phase_begin(sort_phase::quick_sort, {static_cast<std::ptrdiff_t>(last - first)});
+        UnstableSort(first, last, comp);
+        listener.on_phase_end(sort_phase::quick_sort);
+    } else {
+        return Sort(first, last, comp, first, 0, listener);
+    }
+}
+
+//
+// Sorting by cached keys
+//
+
+/**
+ * @brief Comparator of pairs of a cached key and an index, which compares keys only.
+ */
+template <typename Compare>
+struct CachedKeyCompare {
+    constexpr CachedKeyCompare(Compare comp) : comp_{comp} {}
+
+    template <typename Pair>
+    constexpr bool operator()(const Pair& lhs, const Pair& rhs) {
+        return comp_(lhs.first, rhs.first);
+    }
+
+private:
+    Compare comp_;
+};
+
+template <typename Compare, typename Key, typename Index>
+struct IsCheapCompare<CachedKeyCompare<Compare>, std::pair<Key, Index>> : IsCheapCompare<Compare, Key> {};
+
+/**
+ * @brief Permute data so that `data[i]` becomes the element formerly at `data[perm[i].second]`.
  *
- * Though we also considered Tokuda's sequence, this is abandoned since computing the sequence without floating-number
- * is prone to overflow.
+ * Each cycle of the permutation is applied by swaps, one less than its length. Indices are overwritten to mark
+ * elements in place.
  *
  * @param data
+ * @param perm
+ *   @pre {perm[i].second | 0 <= i < len} is a permutation of [0, len)
  * @param len
- *   @pre len >= 2
+ */
+template <typename Iterator, typename PermIterator>
+void ApplyPermutation(Iterator data, PermIterator perm, diff_t<Iterator> len) {
+    using Index = decltype(perm->second);
+    using std::swap;
+
+    for (diff_t<Iterator> i = 0; i < len; ++i) {
+        diff_t<Iterator> cur = i;
+        while (static_cast<diff_t<Iterator>>(perm[cur].second) != i) {
+            auto src = static_cast<diff_t<Iterator>>(perm[cur].second);
+            swap(data[cur], data[src]);
+            perm[cur].second = static_cast<Index>(cur);
+            cur = src;
+        }
+        perm[cur].second = static_cast<Index>(cur);
+    }
+}
+
+/**
+ * @brief Sort data stably by keys, computing the key of each element once while data is sorted in chunks.
+ *
+ * Each chunk of `chunk_len` elements is sorted by sorting pairs of its keys and indices, then permuted accordingly.
+ * Chunks are merged by `MergeInPlace`, which computes keys at every comparison.
+ *
+ * @tparam Index Unsigned integer type, which can represent `chunk_len - 1`
+ * @param first
+ * @param last
+ * @param key_fn
  * @param comp
+ * @param chunk_len
+ *   @pre chunk_len > 0
  */
-template <typename Iterator, typename Compare>
-SAYHISORT_CONSTEXPR_SWAP void ShellSort(Iterator data, diff_t<Iterator> len, Compare comp) {
-    auto [gap, n] = FirstShellSortGap(len);
+template <typename Index, typename Iterator, typename KeyFn, typename Compare>
+void SortByCachedKey(Iterator first, Iterator last, KeyFn& key_fn, Compare comp, diff_t<Iterator> chunk_len) {
+    using Key = std::decay_t<std::invoke_result_t<KeyFn&, typename std::iterator_traits<Iterator>::reference>>;
+    diff_t<Iterator> len = last - first;
 
-    while (true) {
-        diff_t<Iterator> i = gap;
-        do {
-            for (diff_t<Iterator> j = i; j >= gap; j -= gap) {
-                if (!comp(data[j], data[j - gap])) {
-                    break;
-                }
-                swap(data[j - gap], data[j]);
-            }
-        } while (++i < len);
-        if (!n) {
-            break;
+    std::vector<std::pair<Key, Index>> keyed;
+    keyed.reserve(static_cast<std::size_t>(len < chunk_len ? len : chunk_len));
+    for (Iterator chunk = first; chunk != last;) {
+        Iterator chunk_last = last - chunk > chunk_len ? chunk + chunk_len : last;
+        keyed.clear();
+        for (Iterator it = chunk; it != chunk_last; ++it) {
+            keyed.emplace_back(std::invoke(key_fn, *it), static_cast<Index>(it - chunk));
+        }
+        Sort(keyed.begin(), keyed.end(), CachedKeyCompare<Compare>{comp});
+        ApplyPermutation(chunk, keyed.begin(), chunk_last - chunk);
+        chunk = chunk_last;
+    }
+
+    auto key_comp = [&key_fn, &comp](auto&& lhs, auto&& rhs) {
+        return comp(std::invoke(key_fn, lhs), std::invoke(key_fn, rhs));
+    };
+    for (diff_t<Iterator> seq_len = chunk_len; seq_len < len; seq_len = len - seq_len > seq_len ? seq_len * 2 : len) {
+        for (Iterator xs = first; last - xs > seq_len;) {
+            Iterator ys = xs + seq_len;
+            Iterator ys_last = last - ys > seq_len ? ys + seq_len : last;
+            MergeInPlace(xs, ys, ys_last, key_comp);
+            xs = ys_last;
         }
-        gap = NthShellSortGap(--n);
     }
 }
 
 //
-// Full sorting
+// Sorting columns
 //
 
-template <typename Iterator, typename Compare>
-SAYHISORT_CONSTEXPR_SWAP diff_t<Iterator> CollectKeys(Iterator first, Iterator last, diff_t<Iterator> num_desired_keys,
-                                                      Compare comp) {
-    if (first == last) {
-        return 0;
+/**
+ * @brief Proxy reference to the elements at the same position of multiple columns.
+ *
+ * Assignments and swaps are applied to every column, so that columns are permuted together.
+ */
+template <typename... Iterators>
+struct ZipReference {
+    using Value = std::tuple<typename std::iterator_traits<Iterators>::value_type...>;
+
+    constexpr ZipReference(typename std::iterator_traits<Iterators>::reference... refs) : refs{refs...} {}
+    ZipReference(const ZipReference&) = default;
+
+    constexpr ZipReference& operator=(const ZipReference& other) {
+        refs = other.refs;
+        return *this;
     }
-    if (num_desired_keys <= 1) {
-        return num_desired_keys;
+
+    constexpr ZipReference& operator=(ZipReference&& other) {
+        refs = std::move(other.refs);
+        return *this;
     }
 
-    Iterator keys = first;
-    Iterator keys_last = first + 1;
+    constexpr ZipReference& operator=(Value&& value) {
+        refs = std::move(value);
+        return *this;
+    }
 
-    for (Iterator cur = keys_last; cur < last; ++cur) {
-        Iterator inspos = BinarySearch<false>(keys, keys_last, cur, comp);
-        if (inspos == keys_last || comp(*cur, *inspos)) {
-            // Rotate keys forward so that insertion works in O(num_keys)
-            Rotate(keys, keys_last, cur);
-            keys += cur - keys_last;
-            inspos += cur - keys_last;
-            keys_last = cur;
-            // Insert the new key
-            Rotate(inspos, keys_last, cur + 1);
-            if (++keys_last - keys == num_desired_keys) {
-                break;
-            }
-        }
+    constexpr operator Value() && { return std::apply([](auto&... xs) { return Value{std::move(xs)...}; }, refs); }
+
+    friend SAYHISORT_CONSTEXPR_SWAP void swap(ZipReference lhs, ZipReference rhs) {
+        lhs.SwapEach(rhs, std::index_sequence_for<Iterators...>{});
     }
 
-    Rotate(first, keys, keys_last);
-    return keys_last - keys;
+    std::tuple<typename std::iterator_traits<Iterators>::reference...> refs;
+
+private:
+    template <std::size_t... Is>
+    SAYHISORT_CONSTEXPR_SWAP void SwapEach(ZipReference& other, std::index_sequence<Is...>) {
+        using std::swap;
+        (swap(std::get<Is>(refs), std::get<Is>(other.refs)), ...);
+    }
+};
+
+/**
+ * @brief Random access iterator over multiple columns advanced together, which dereferences to `ZipReference`.
+ *
+ * Positions are compared and subtracted by the first column only.
+ */
+template <typename Iterator, typename... Iterators>
+struct ZipIterator {
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = typename ZipReference<Iterator, Iterators...>::Value;
+    using difference_type = diff_t<Iterator>;
+    using reference = ZipReference<Iterator, Iterators...>;
+    using pointer = void;
+
+    constexpr ZipIterator() = default;
+    constexpr ZipIterator(Iterator it, Iterators... its) : its{it, its...} {}
+
+    constexpr reference operator*() const {
+        return std::apply([](const auto&... xs) { return reference{*xs...}; }, its);
+    }
+    constexpr reference operator[](difference_type n) const { return *(*this + n); }
+
+    constexpr ZipIterator& operator+=(difference_type n) {
+        std::apply([n](auto&... xs) { ((xs += n), ...); }, its);
+        return *this;
+    }
+    constexpr ZipIterator& operator-=(difference_type n) { return *this += -n; }
+    constexpr ZipIterator& operator++() { return *this += 1; }
+    constexpr ZipIterator& operator--() { return *this -= 1; }
+    constexpr ZipIterator operator++(int) {
+        ZipIterator old = *this;
+        ++*this;
+        return old;
+    }
+    constexpr ZipIterator operator--(int) {
+        ZipIterator old = *this;
+        --*this;
+        return old;
+    }
+
+    friend constexpr ZipIterator operator+(ZipIterator it, difference_type n) { return it += n; }
+    friend constexpr ZipIterator operator+(difference_type n, ZipIterator it) { return it += n; }
+    friend constexpr ZipIterator operator-(ZipIterator it, difference_type n) { return it -= n; }
+    friend constexpr difference_type operator-(const ZipIterator& lhs, const ZipIterator& rhs) {
+        return std::get<0>(lhs.its) - std::get<0>(rhs.its);
+    }
+
+    friend constexpr bool operator==(const ZipIterator& lhs, const ZipIterator& rhs) {
+        return std::get<0>(lhs.its) == std::get<0>(rhs.its);
+    }
+    friend constexpr bool operator!=(const ZipIterator& lhs, const ZipIterator& rhs) { return !(lhs == rhs); }
+    friend constexpr bool operator<(const ZipIterator& lhs, const ZipIterator& rhs) {
+        return std::get<0>(lhs.its) < std::get<0>(rhs.its);
+    }
+    friend constexpr bool operator>(const ZipIterator& lhs, const ZipIterator& rhs) { return rhs < lhs; }
+    friend constexpr bool operator<=(const ZipIterator& lhs, const ZipIterator& rhs) { return !(rhs < lhs); }
+    friend constexpr bool operator>=(const ZipIterator& lhs, const ZipIterator& rhs) { return !(lhs < rhs); }
+
+    std::tuple<Iterator, Iterators...> its;
+};
+
+template <typename Fn, typename Zip, typename... Zips, std::size_t... Is>
+SAYHISORT_CONSTEXPR_SWAP void ForEachColumnImpl(Fn& fn, std::index_sequence<Is...>, Zip& zip, Zips&... zips) {
+    auto apply_column = [&](auto col) {
+        fn(std::get<decltype(col)::value>(zip.its), std::get<decltype(col)::value>(zips.its)...);
+    };
+    (apply_column(std::integral_constant<std::size_t, Is>{}), ...);
 }
 
-template <typename SsizeT>
-struct MergeSortControl {
-    /**
-     * @param num_keys
-     *   @pre num_keys == 0 or num_keys >= 8
-     * @param data_len
-     *   @pre data_len > 8
-     * @post 5 <= this->seq_len <= 8
-     */
-    constexpr MergeSortControl(SsizeT num_keys, SsizeT data_len) : data_len{data_len} {
-        if (num_keys) {
-            // imit_len >= 2
-            imit_len = (num_keys + 2) / 4 * 2 - 2;
-            // buf_len >= 6
-            buf_len = num_keys - imit_len;
-            // bufferable_len >= 12
-            bufferable_len = (imit_len + 2) / 2 * buf_len;
-        }
+template <typename Fn, typename Zip, typename... Zips>
+SAYHISORT_CONSTEXPR_SWAP void ForEachColumn(Fn fn, Zip zip, Zips... zips) {
+    constexpr std::size_t num_cols = std::tuple_size_v<decltype(zip.its)>;
+    ForEachColumnImpl(fn, std::make_index_sequence<num_cols>{}, zip, zips...);
+}
 
-        while ((data_len - 1) >> (log2_num_seqs + 3)) {
-            ++log2_num_seqs;
-        }
-        // seq_len <= 8, so seq_len < bufferable_len holds if num_keys != 0
-        seq_len = ((data_len - 1) >> log2_num_seqs) + 1;
+/**
+ * @brief Comparator of `ZipReference`, which compares elements of the first column.
+ */
+template <typename Compare>
+struct ZipKeyCompare {
+    constexpr ZipKeyCompare(Compare comp) : comp_{comp} {}
+
+    template <typename Ref>
+    constexpr bool operator()(const Ref& lhs, const Ref& rhs) {
+        return comp_(std::get<0>(lhs.refs), std::get<0>(rhs.refs));
     }
 
-    constexpr SsizeT Next() {
-        --log2_num_seqs;
-        seq_len = ((data_len - 1) >> log2_num_seqs) + 1;
+private:
+    Compare comp_;
+};
 
-        if (!buf_len) {
-            return 0;
-        }
-        forward = !forward;
+template <typename Compare, typename Key, typename... Ts>
+struct IsCheapCompare<ZipKeyCompare<Compare>, std::tuple<Key, Ts...>> : IsCheapCompare<Compare, Key> {};
 
-        if (!log2_num_seqs || seq_len > bufferable_len) {
-            SsizeT old_buf_len = buf_len;
-            imit_len += buf_len;
-            buf_len = 0;
-            return old_buf_len;
-        }
-        return 0;
+//
+// In-place merging
+//
+
+/**
+ * @brief Merge adjacent sorted sequences in-place, by Hwang-Lin merge of the shorter into the longer.
+ *
+ * If the shorter is on the right, both are merged in reverse order through reverse iterators. Then ties go to the
+ * reversed right sequence first, which keeps the merge stable.
+ *
+ * @param first
+ * @param middle
+ * @param last
+ * @param comp
+ * @note It takes about m * log2(n / m) comparisons and O(m * m + n) swaps, where `m` and `n` are the lengths of the
+ *       shorter and the longer sequences.
+ */
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void MergeUnbalanced(Iterator first, Iterator middle, Iterator last, Compare comp) {
+    if (first == middle || middle == last || !comp(*middle, *(middle - 1))) {
+        return;
+    }
+    if (middle - first <= last - middle) {
+        MergeWithoutBuf<false, SearchKind::kHwangLin>(first, middle, last, comp);
+    } else {
+        MergeWithoutBuf<false, SearchKind::kHwangLin>(std::make_reverse_iterator(last),
+                                                      std::make_reverse_iterator(middle),
+                                                      std::make_reverse_iterator(first), ReverseCompare{comp});
+    }
+}
+
+/**
+ * @brief Merge adjacent sorted sequences stably in-place, by block merge.
+ *
+ * Keys are collected from the left sequence; half of them imitates the order of blocks, and the other half is the
+ * buffer for merging blocks. Like `Sort`, keys are sorted and merged back at last.
+ *
+ * @param first
+ * @param middle
+ * @param last
+ * @param comp
+ * @note It takes O(N) comparisons and swaps, where `N = last - first`. If the left sequence has less than about
+ *       2 * sqrt(N) distinct keys, the rest is merged by `MergeInPlace` in O(N log(N)). Sequences shorter than
+ *       sqrt(N) are merged by `MergeUnbalanced`, and ones shorter than N / 16 by `MergeInPlace`, whose rotations are
+ *       faster there.
+ */
+template <typename Iterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void InplaceMerge(Iterator first, Iterator middle, Iterator last, Compare comp) {
+    if (first == middle || middle == last || !comp(*middle, *(middle - 1))) {
+        return;
     }
+    // Elements already in place are excluded
+    first = BinarySearch<true>(first, middle, middle, comp);
+    last = BinarySearch<false>(middle, last, middle - 1, comp);
 
-    /**
-     * imit_len is positive and multiple of 2.
-     * imit_len + buf_len = num_keys.
-     */
-    SsizeT imit_len = 0;
-    /**
-     * buf_len is non-negative.
-     * If buf_len > 0
-     *   - seq_len <= bufferable_len
-     *   - imit_len + 2 <= buf_len
-     */
-    SsizeT buf_len = 0;
-    //! bufferable_len = ((imit_len + 2) / 2) * buf_len
-    SsizeT bufferable_len = 0;
-    //! data_len > 8
-    SsizeT data_len;
-
-    SsizeT log2_num_seqs = 1;
-    SsizeT seq_len{};
-    bool forward = true;
-};
+    diff_t<Iterator> len = last - first;
+    if (len <= 16) {
+        return MergeUnbalanced(first, middle, last, comp);
+    }
+    diff_t<Iterator> block_len = OverApproxSqrt(len);
+    diff_t<Iterator> shorter_len = std::min(middle - first, last - middle);
+    if (shorter_len <= block_len) {
+        return MergeUnbalanced(first, middle, last, comp);
+    }
+    // Rotations are faster than block merge if either sequence is much shorter. Otherwise both sequences need a full
+    // block or more besides the keys from the left.
+    if (shorter_len <= len / 16 || middle - first <= block_len * 3) {
+        return MergeInPlace(first, middle, last, comp);
+    }
 
-template <typename SsizeT>
-constexpr BlockingParam<SsizeT> DetermineBlocking(const MergeSortControl<SsizeT>& ctrl) {
-    SsizeT num_blocks = ctrl.imit_len + 2;
-    SsizeT seq_len = ctrl.seq_len;
+    diff_t<Iterator> num_desired_keys = block_len * 2;
+    diff_t<Iterator> num_keys = CollectKeys(first, middle, num_desired_keys, comp);
+    Iterator data = first + num_keys;
 
-    if (ctrl.buf_len) {
-        // We don't need to perform runtime-checking so that computed `num_blocks` fits in imitation buffer.
-        // Since
-        //   seq_len <= (imit_len + 2) / 2 * buf_len
-        // is assured,
-        //   ceil(seq_len / buf_len) * 2 <= imit_len + 2
-        // always holds.
-        num_blocks = ((seq_len - 1) / ctrl.buf_len + 1) * 2;
-    } else {
-        // max_num_blocks must be a multple of 2 and under-approx of sqrt(2 * seq_len)
-        SsizeT max_num_blocks = seq_len < 12 ? 2 : seq_len / OverApproxSqrt(seq_len * 2) * 2;
-        if (num_blocks > max_num_blocks) {
-            num_blocks = max_num_blocks;
-        }
+    if (num_keys < num_desired_keys) {
+        MergeInPlace(data, middle, last, comp);
+        MergeWithoutBuf<false, SearchKind::kHwangLin>(first, data, last, comp);
+        return;
     }
 
-    // We need to proof `residual_len >= 2` to assure that all blocks have positive length.
-    // (Note that `residual_len` may be decremented once in `MergeOneLevel`.)
-    // {{{ Proof
-    // We first show the following lemma. Let `N` and `m` be positive integers, such that
-    // `N >= m ** 2`, `N >= 2` and `m >= 1`.
-    //
-    //   (lemma):  N - ceil(N / m) * (m - 1) >= 2 .
-    //
-    // There are three cases.
-    //
-    //   (1):  m = 1 .
-    //   (2):  N = m ** 2, and m >= 2 .
-    //   (3):  N >= (m ** 2) + 1, and m >= 2 .
-    //
-    // If case (1) and (2), it's trivial to check that (lemma) holds.
-    // For case (3), we can use the following property:
-    //
-    //   ceil(N / m) <= (N / m) + ((m - 1) / m) .
-    //
-    // By multiplying `m - 1` to left and right hand sides, we have
-    //
-    //   ceil(N / m) * (m - 1) <= N + (m - 1) - ceil(N / m) .
-    //
-    // Since `N >= (m ** 2) + 1` from (3), `ceil(N / m) >= m + 1` holds. Therefore
-    //
-    //   ceil(N / m) * (m - 1) <= N + (m - 1) - (m + 1)
-    //                         =  N - 2 ,
-    //
-    // which is equivalent to (lemma). Thus the lemma is proven.
-    //
-    // Now it's enough to show that
-    //
-    //   (proposition):  seq_len >= (num_blocks / 2) ** 2 ,
-    //   (*):            seq_len >= 2 , and
-    //   (**):           num_blocks / 2 >= 1 .
-    //
-    // Note that (*) and (**) are immediate from the function's requirement.
-    //
-    // When `buf_len = 0`, the definition of `max_num_blocks` ensures that (proposition) is satisfied.
-    // For the case `buf_len > 0`, we use the following constraints.
-    //
-    //   (a):  imit_len + 2 <= buf_len .                   (by MergeSortControll)
-    //   (b):  seq_len <= (imit_len + 2) / 2 * buf_len .   (by MergeSortControll)
-    //   (c):  num_blocks / 2 = ceil(seq_len / buf_len) .  (by definition)
-    //
-    // From (a) and (b), we have `seq_len <= (buf_len ** 2) / 2`. Therefore
-    //
-    //   (d):  buf_len >= sqrt(2) * sqrt(seq_len)
-    //
-    // holds. Using (c) and (d), we have
-    //
-    //   (e):  num_blocks / 2 <= ceil(sqrt(seq_len) / sqrt(2)) .
-    //                        <= (sqrt(seq_len) / sqrt(2)) + 1
-    //
-    // Thanks to (e), it's easy to show that the following (subprop) is enough to prove (proposition).
-    //
-    //   (subprop):  sqrt(seq_len) >= (sqrt(seq_len) / sqrt(2)) + 1
-    //
-    // As the function requires `seq_len >= 8`, (subprop) is always satisfied. Thus (proposition) is true.
-    // Therefore We have proven `residual_len >= 2`.
-    // }}}
-
-    SsizeT block_len = (seq_len - 1) / (num_blocks / 2) + 1;
-    SsizeT residual_len = seq_len - block_len * (num_blocks / 2 - 1);
+    // Since block_len >= sqrt(len), both imitation buffer and buffer have room for (len - 2) / block_len blocks
+    diff_t<Iterator> num_left_blocks = (middle - data - 1) / block_len + 1;
+    diff_t<Iterator> num_right_blocks = (last - middle - 1) / block_len + 1;
+    BlockingParam<diff_t<Iterator>> p{num_left_blocks + num_right_blocks, block_len,
+                                      (middle - data) - (num_left_blocks - 1) * block_len,
+                                      (last - middle) - (num_right_blocks - 1) * block_len};
+    Iterator buf = first + block_len;
+    MergeBlocking<true>(first, buf, data, p, num_left_blocks, comp);
 
-    return {num_blocks, block_len, residual_len, residual_len};
+    // The buffer is now at the end. Its keys are the first of their equal elements, like the imitation buffer.
+    ShellSort(buf, block_len, comp);
+    MergeWithoutBuf<false, SearchKind::kHwangLin>(first, first + block_len, buf, comp);
+    MergeWithoutBuf<true, SearchKind::kHwangLin>(std::make_reverse_iterator(last), std::make_reverse_iterator(buf),
+                                                 std::make_reverse_iterator(first), ReverseCompare{comp});
 }
 
+//
+// Adaptive sorting
+//
+
+//! At most this number of natural runs are utilized by `AdaptiveSort`.
+constexpr int kMaxNaturalRuns = 16;
+
+/**
+ * @brief Sort data stably, utilizing natural runs.
+ *
+ * Non-descending runs and strictly descending runs are detected first. A run is utilized if it's not shorter than
+ * `len / kMaxNaturalRuns`. Strictly descending runs are reversed, which doesn't break stability. Stretches between
+ * utilized runs are sorted by `Sort`. A stretch shorter than a run, such as a few elements appended to sorted data, is
+ * merged into the preceding run at once, which `InplaceMerge` does by `MergeUnbalanced` if it's short enough. Then all
+ * segments are merged pairwise by `InplaceMerge`.
+ *
+ * Already sorted data and reversed data are sorted in O(N) time, and so is sorted data followed by O(sqrt(N)) elements.
+ *
+ * @param first
+ * @param last
+ * @param comp
+ */
 template <typename Iterator, typename Compare>
-SAYHISORT_CONSTEXPR_SWAP void Sort(Iterator first, Iterator last, Compare comp) {
+SAYHISORT_CONSTEXPR_SWAP void AdaptiveSort(Iterator first, Iterator last, Compare comp) {
     diff_t<Iterator> len = last - first;
     if (len <= 8) {
         return Sort0To8(first, len, comp);
     }
+    diff_t<Iterator> min_run_len = (len - 1) / kMaxNaturalRuns + 1;
 
-    Iterator imit = first;
-    diff_t<Iterator> num_keys = 0;
-    if (len > 16) {
-        diff_t<Iterator> num_desired_keys = 2 * OverApproxSqrt(len) - 2;
-        num_keys = CollectKeys(first, last, num_desired_keys, comp);
-        if (num_keys < 8) {
-            imit += num_keys;
-            len -= num_keys;
-            num_keys = 0;
-        }
-    }
-
-    // If len = 17, num_keys is at most 8; so data_len > 8
-    diff_t<Iterator> data_len = len - num_keys;
-    MergeSortControl ctrl{num_keys, data_len};
-
-    Iterator data = imit + num_keys;
-    SortLeaves(data, ctrl.seq_len, {ctrl.data_len, ctrl.log2_num_seqs}, comp);
+    // Segments are either utilized runs or stretches between them. The latter are sorted right after detected, and
+    // merged into the preceding run if short.
+    Iterator bounds[kMaxNaturalRuns * 2 + 2] = {};
+    int num_segs = 0;
+    bounds[0] = first;
 
-    do {
-        BlockingParam p = DetermineBlocking(ctrl);
+    Iterator stretch = first;
+    auto add_stretch = [&](Iterator stretch_last) {
+        Sort(stretch, stretch_last, comp);
+        if (num_segs && stretch_last - stretch < min_run_len) {
+            InplaceMerge(bounds[num_segs - 1], stretch, stretch_last, comp);
+        } else {
+            ++num_segs;
+        }
+        bounds[num_segs] = stretch_last;
+    };
 
-        if (!ctrl.buf_len) {
-            MergeOneLevel<false, true>(imit, imit + ctrl.imit_len, data, ctrl.seq_len,
-                                       {ctrl.data_len, ctrl.log2_num_seqs}, p, comp);
-        } else if (ctrl.forward) {
-            MergeOneLevel<true, true>(imit, imit + ctrl.imit_len, data, ctrl.seq_len,
-                                      {ctrl.data_len, ctrl.log2_num_seqs}, p, comp);
+    Iterator run = first;
+    while (run != last) {
+        Iterator run_last = run + 1;
+        bool descending = run_last != last && comp(*run_last, *run);
+        if (descending) {
+            do {
+                ++run_last;
+            } while (run_last != last && comp(*run_last, *(run_last - 1)));
         } else {
-            MergeOneLevel<true, false>(imit, last, last - ctrl.buf_len, ctrl.seq_len,
-                                       {ctrl.data_len, ctrl.log2_num_seqs}, p, comp);
+            while (run_last != last && !comp(*run_last, *(run_last - 1))) {
+                ++run_last;
+            }
         }
 
-        if (diff_t<Iterator> old_buf_len = ctrl.Next()) {
-            Iterator buf = data - old_buf_len;
-            if (!ctrl.forward) {
-                Iterator back_buf = last;
-                Iterator back_data = last - old_buf_len;
-                do {
-                    swap(*--back_data, *--back_buf);
-                } while (back_data != buf);
-                ctrl.forward = true;
+        if (run_last - run >= min_run_len) {
+            if (descending) {
+                for (Iterator l = run, r = run_last; l < --r; ++l) {
+                    swap(*l, *r);
+                }
             }
-            ShellSort(buf, old_buf_len, comp);
-            MergeWithoutBuf<false>(imit, buf, data, comp);
+            if (stretch != run) {
+                add_stretch(run);
+            }
+            bounds[++num_segs] = run_last;
+            stretch = run_last;
         }
-    } while (ctrl.log2_num_seqs);
+        run = run_last;
+    }
+    if (stretch != last) {
+        add_stretch(last);
+    }
 
-    if (first != data) {
-        MergeWithoutBuf<false>(first, data, last, comp);
+    for (int step = 1; step < num_segs; step *= 2) {
+        for (int i = 0; i + step < num_segs; i += step * 2) {
+            int i_last = i + step * 2 < num_segs ? i + step * 2 : num_segs;
+            InplaceMerge(bounds[i], bounds[i + step], bounds[i_last], comp);
+        }
     }
 }
 
 }  // namespace
 }  // namespace detail
 
+/**
+ * @brief Sort stably.
+ *
+ * Integers compared by `std::less` or `std::greater` are sorted by an unstable quick sort, which is faster and gives
+ * the same result, since equivalent integers are indistinguishable.
+ */
 template <typename RandomAccessIterator>
 SAYHISORT_CONSTEXPR_SWAP void sort(RandomAccessIterator first, RandomAccessIterator last) {
-    return detail::Sort(first, last, std::less<>{});
+    return detail::DispatchSort(first, last, std::less<>{});
 }
 
 template <typename RandomAccessIterator, typename Compare>
 SAYHISORT_CONSTEXPR_SWAP void sort(RandomAccessIterator first, RandomAccessIterator last, Compare comp) {
-    return detail::Sort(first, last, comp);
+    return detail::DispatchSort(first, last, comp);
+}
+
+/**
+ * @brief Sort stably, accumulating counters of the work done into `stats`.
+ *
+ * It's slower than `sort` without stats due to the counting, and neither SIMD sorting networks nor SIMD partitioning
+ * are used, since they don't call the comparator. Otherwise the same code paths are taken, including the unstable
+ * quick sort of integers compared by `std::less` or `std::greater`.
+ */
+template <typename RandomAccessIterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void sort(RandomAccessIterator first, RandomAccessIterator last, Compare comp,
+                                   sort_stats& stats) {
+    return detail::DispatchSort(first, last, detail::ObservedCompare<Compare>{comp, &stats});
+}
+
+/**
+ * @brief Sort stably, notifying `listener` of the beginning and the end of each phase.
+ *
+ * `listener` must have member functions `on_phase_begin(sort_phase, const sort_phase_info&)` and
+ * `on_phase_end(sort_phase)`, which can attach timers or hardware counters to phases. Phases aren't nested, and
+ * `merge_level` is reported once per level. Integers compared by `std::less` or `std::greater` are sorted by the
+ * unstable quick sort as without a listener, which is reported as a single `quick_sort` phase.
+ */
+template <typename RandomAccessIterator, typename Compare, typename Listener,
+          std::enable_if_t<detail::kIsPhaseListener<Listener>, std::nullptr_t> = nullptr>
+SAYHISORT_CONSTEXPR_SWAP void sort(RandomAccessIterator first, RandomAccessIterator last, Compare comp,
+                                   Listener& listener) {
+    return detail::DispatchSort(first, last, comp, listener);
+}
+
+/**
+ * @brief Sort stably, using a caller-supplied buffer as scratch space.
+ *
+ * Any length of buffer is accepted. If the buffer is at least as long as the half of the data, no keys are collected
+ * and every level is merged with the buffer. Otherwise it's used for lower levels and for merging collected keys back.
+ * Elements in the buffer are swapped with the data while sorting, and permuted in unspecified order on return.
+ */
+template <typename RandomAccessIterator, typename BufferIterator>
+SAYHISORT_CONSTEXPR_SWAP void sort(RandomAccessIterator first, RandomAccessIterator last, BufferIterator buf_first,
+                                   BufferIterator buf_last) {
+    return detail::Sort(first, last, std::less<>{}, buf_first,
+                        static_cast<detail::diff_t<RandomAccessIterator>>(buf_last - buf_first));
+}
+
+template <typename RandomAccessIterator, typename BufferIterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void sort(RandomAccessIterator first, RandomAccessIterator last, BufferIterator buf_first,
+                                   BufferIterator buf_last, Compare comp) {
+    return detail::Sort(first, last, comp, buf_first,
+                        static_cast<detail::diff_t<RandomAccessIterator>>(buf_last - buf_first));
+}
+
+/**
+ * @brief Sort stably, utilizing runs already sorted in ascending or strictly descending order.
+ *
+ * It runs in O(N) time for sorted or reversed data, or sorted data followed by up to about sqrt(N) elements, and gets
+ * faster when data consists of a few sorted sequences.
+ * Otherwise it's slightly slower than `sort` due to the run detection.
+ */
+template <typename RandomAccessIterator>
+SAYHISORT_CONSTEXPR_SWAP void adaptive_sort(RandomAccessIterator first, RandomAccessIterator last) {
+    return detail::AdaptiveSort(first, last, std::less<>{});
+}
+
+template <typename RandomAccessIterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void adaptive_sort(RandomAccessIterator first, RandomAccessIterator last, Compare comp) {
+    return detail::AdaptiveSort(first, last, comp);
+}
+
+/**
+ * @brief Sort a column of keys stably, and permute payload columns in the same way.
+ *
+ * Columns are sorted together through a proxy iterator, without copying rows out. Each payload column is given by
+ * its first iterator, and must be at least as long as the key column. Keys are compared by `comp`.
+ */
+template <typename KeyIterator, typename Compare, typename... PayloadIterators>
+SAYHISORT_CONSTEXPR_SWAP void sort_columns(KeyIterator keys_first, KeyIterator keys_last, Compare comp,
+                                           PayloadIterators... payload_firsts) {
+    using Zip = detail::ZipIterator<KeyIterator, PayloadIterators...>;
+    Zip first{keys_first, payload_firsts...};
+    return detail::Sort(first, first + (keys_last - keys_first), detail::ZipKeyCompare<Compare>{comp});
+}
+
+/**
+ * @brief Sort stably by `key_fn(element)`, computing the key of each element only once.
+ *
+ * Keys are cached with indices of elements in a temporary array, which is sorted and then applied to data as a
+ * permutation. It's worth it when key extraction is expensive, trading O(N) extra memory for O(N log(N)) calls of
+ * `key_fn`.
+ */
+template <typename RandomAccessIterator, typename KeyFn, typename Compare>
+void sort_by_cached_key(RandomAccessIterator first, RandomAccessIterator last, KeyFn key_fn, Compare comp) {
+    auto len = last - first;
+    if (len <= 1) {
+        return;
+    }
+    if (static_cast<std::uint64_t>(len - 1) <= std::numeric_limits<std::uint32_t>::max()) {
+        return detail::SortByCachedKey<std::uint32_t>(first, last, key_fn, comp, len);
+    }
+    return detail::SortByCachedKey<std::size_t>(first, last, key_fn, comp, len);
+}
+
+template <typename RandomAccessIterator, typename KeyFn>
+void sort_by_cached_key(RandomAccessIterator first, RandomAccessIterator last, KeyFn key_fn) {
+    return sort_by_cached_key(first, last, key_fn, std::less<>{});
+}
+
+/**
+ * @brief Sort stably by `key_fn(element)`, caching at most `max_cached_keys` keys at once.
+ *
+ * Data is sorted by cached keys in chunks of `max_cached_keys` elements, and the chunks are merged in-place by
+ * computing keys at each comparison. So extra memory is bounded, while merging calls `key_fn`
+ * O(N log(N / max_cached_keys)) times.
+ *
+ * @param max_cached_keys
+ *   @pre max_cached_keys > 0
+ */
+template <typename RandomAccessIterator, typename KeyFn, typename Compare>
+void sort_by_cached_key(RandomAccessIterator first, RandomAccessIterator last, KeyFn key_fn, Compare comp,
+                        std::ptrdiff_t max_cached_keys) {
+    auto len = last - first;
+    if (len <= 1) {
+        return;
+    }
+    auto chunk_len = static_cast<decltype(len)>(len < max_cached_keys ? len : max_cached_keys);
+    if (static_cast<std::uint64_t>(chunk_len - 1) <= std::numeric_limits<std::uint32_t>::max()) {
+        return detail::SortByCachedKey<std::uint32_t>(first, last, key_fn, comp, chunk_len);
+    }
+    return detail::SortByCachedKey<std::size_t>(first, last, key_fn, comp, chunk_len);
 }
 
+/**
+ * @brief Merge adjacent sorted ranges `[first, middle)` and `[middle, last)` stably in-place, when either of them is
+ * much shorter than the other.
+ *
+ * Elements of the shorter range are inserted into the longer by Hwang and Lin's algorithm, which takes about
+ * m * log2(n / m) comparisons, close to the lower bound, where `m` and `n` are the lengths of the shorter and the
+ * longer. `std::inplace_merge` takes up to m + n - 1 comparisons, or O((m + n) log(m + n)) without memory. Elements are
+ * moved by rotations, so it takes O(m * m + n) swaps; it suits small sorted deltas into large sorted tables, not ranges
+ * of similar lengths.
+ */
+template <typename RandomAccessIterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void inplace_merge_unbalanced(RandomAccessIterator first, RandomAccessIterator middle,
+                                                       RandomAccessIterator last, Compare comp) {
+    return detail::MergeUnbalanced(first, middle, last, comp);
+}
+
+template <typename RandomAccessIterator>
+SAYHISORT_CONSTEXPR_SWAP void inplace_merge_unbalanced(RandomAccessIterator first, RandomAccessIterator middle,
+                                                       RandomAccessIterator last) {
+    return detail::MergeUnbalanced(first, middle, last, std::less<>{});
+}
+
+/**
+ * @brief Merge adjacent sorted ranges `[first, middle)` and `[middle, last)` stably in-place, like
+ * `std::inplace_merge` but without allocation.
+ *
+ * Up to 2 * sqrt(N) distinct elements of the left range are borrowed as an internal buffer and as keys to imitate the
+ * order of blocks, so that the ranges are merged by block merge in O(N) comparisons and swaps, where
+ * `N = last - first`. If the left range has fewer distinct elements, it takes O(N log(N)), as `std::inplace_merge`
+ * does when it fails to allocate. If either range is shorter than N / 16, it's merged by rotations, which are faster
+ * there; the shorter one is inserted as `inplace_merge_unbalanced` does if it's shorter than sqrt(N).
+ */
+template <typename RandomAccessIterator, typename Compare>
+SAYHISORT_CONSTEXPR_SWAP void inplace_merge(RandomAccessIterator first, RandomAccessIterator middle,
+                                            RandomAccessIterator last, Compare comp) {
+    return detail::InplaceMerge(first, middle, last, comp);
+}
+
+template <typename RandomAccessIterator>
+SAYHISORT_CONSTEXPR_SWAP void inplace_merge(RandomAccessIterator first, RandomAccessIterator middle,
+                                            RandomAccessIterator last) {
+    return detail::InplaceMerge(first, middle, last, std::less<>{});
+}
+
+#if __cpp_lib_ranges >= 201911L
+namespace ranges {
+
+/**
+ * @brief Function object type of `sayhisort::ranges::sort`, which sorts stably like `std::ranges::stable_sort`.
+ *
+ * The range may be delimited by a sentinel, and elements are compared by their projections. Projections are passed
+ * through to the sort, so that it can tell the cost of comparisons; e.g. comparing arithmetic data members by
+ * `std::ranges::less` is regarded as cheap as comparing the values themselves.
+ */
+struct sort_fn {
+    template <std::random_access_iterator Iterator, std::sentinel_for<Iterator> Sentinel,
+              typename Compare = std::ranges::less, typename Proj = std::identity>
+        requires std::sortable<Iterator, Compare, Proj>
+    SAYHISORT_CONSTEXPR_SWAP Iterator operator()(Iterator first, Sentinel last, Compare comp = {},
+                                                 Proj proj = {}) const {
+        Iterator last_it = std::ranges::next(first, last);
+        if constexpr (std::is_same_v<Proj, std::identity>) {
+            detail::DispatchSort(first, last_it, comp);
+        } else {
+            detail::Sort(first, last_it, detail::ProjectedCompare<Compare, Proj>{comp, proj});
+        }
+        return last_it;
+    }
+
+    template <std::ranges::random_access_range Range, typename Compare = std::ranges::less,
+              typename Proj = std::identity>
+        requires std::sortable<std::ranges::iterator_t<Range>, Compare, Proj>
+    SAYHISORT_CONSTEXPR_SWAP std::ranges::borrowed_iterator_t<Range> operator()(Range&& range, Compare comp = {},
+                                                                                Proj proj = {}) const {
+        return (*this)(std::ranges::begin(range), std::ranges::end(range), std::move(comp), std::move(proj));
+    }
+};
+
+inline constexpr sort_fn sort{};
+
+}  // namespace ranges
+#endif
+
 }  // namespace sayhisort
 
 #endif  // SAYHISORT_H
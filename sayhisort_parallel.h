@@ -0,0 +1,259 @@
+#ifndef SAYHISORT_PARALLEL_H
+#define SAYHISORT_PARALLEL_H
+
+// Multithreaded sorting, which is kept apart from sayhisort.h so that the sequential sorts don't depend on threads.
+
+#include "sayhisort.h"
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace sayhisort {
+
+namespace detail {
+namespace {
+
+//
+// Parallel sorting
+//
+
+//! Sequences shorter than this are not worth being sorted or merged by another thread.
+constexpr std::ptrdiff_t kMinParallelSeqLen = 4096;
+
+/**
+ * @brief Run `fn(0), fn(1), ..., fn(num_tasks - 1)` concurrently by up to `num_threads` threads.
+ *
+ * The calling thread also works on the tasks. If a task throws, the first exception is rethrown after all threads are
+ * joined. Failure to spawn threads isn't an error; the remaining tasks are run by the threads already working.
+ */
+template <typename Fn>
+void ParallelFor(std::size_t num_tasks, unsigned num_threads, Fn fn) {
+    std::atomic<std::size_t> next_task{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+
+    auto worker = [&]() {
+        try {
+            for (std::size_t i; (i = next_task.fetch_add(1, std::memory_order_relaxed)) < num_tasks;) {
+                fn(i);
+            }
+        } catch (...) {
+            if (!failed.exchange(true)) {
+                error = std::current_exception();
+            }
+            next_task.store(num_tasks, std::memory_order_relaxed);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    std::size_t num_workers = num_tasks < num_threads ? num_tasks : num_threads;
+    if (num_workers > 1) {
+        threads.reserve(num_workers - 1);
+    }
+    for (std::size_t i = 1; i < num_workers; ++i) {
+        try {
+            threads.emplace_back(worker);
+        } catch (const std::system_error&) {
+            break;
+        }
+    }
+    worker();
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+/**
+ * @brief Reverse data by multiple threads.
+ *
+ * @param first
+ * @param last
+ * @param num_threads
+ *   @pre num_threads >= 1
+ */
+template <typename Iterator>
+void ParallelReverse(Iterator first, Iterator last, unsigned num_threads) {
+    diff_t<Iterator> half_len = (last - first) / 2;
+    diff_t<Iterator> num_chunks = (half_len - 1) / kMinParallelSeqLen + 1;
+    if (num_chunks > static_cast<diff_t<Iterator>>(num_threads)) {
+        num_chunks = num_threads;
+    }
+    if (num_chunks <= 1) {
+        return std::reverse(first, last);
+    }
+
+    ParallelFor(num_chunks, num_threads, [&](std::size_t i) {
+        diff_t<Iterator> chunk_first = half_len * static_cast<diff_t<Iterator>>(i) / num_chunks;
+        diff_t<Iterator> chunk_last = half_len * static_cast<diff_t<Iterator>>(i + 1) / num_chunks;
+        Iterator left = first + chunk_first;
+        Iterator right = last - chunk_first;
+        for (diff_t<Iterator> k = chunk_first; k < chunk_last; ++k) {
+            swap(*left++, *--right);
+        }
+    });
+}
+
+/**
+ * @brief Rotate two chunks split at `middle` by multiple threads.
+ *
+ * @param first
+ * @param middle
+ * @param last
+ * @param num_threads
+ *   @pre num_threads >= 1
+ */
+template <typename Iterator>
+void ParallelRotate(Iterator first, Iterator middle, Iterator last, unsigned num_threads) {
+    if (num_threads <= 1 || last - first < kMinParallelSeqLen * 2) {
+        return Rotate(first, middle, last);
+    }
+    // Triple reversal, each of which is easily parallelized
+    ParallelReverse(first, middle, num_threads);
+    ParallelReverse(middle, last, num_threads);
+    ParallelReverse(first, last, num_threads);
+}
+
+/**
+ * @brief Merge adjacent sequences xs and ys in-place by multiple threads.
+ *
+ * The merge path is split at its middle point, that is, the first half of the merged sequence consists of `xs[0:i]`
+ * and `ys[0:j]`, where `i + j` is the half of the total length. After `xs[i:]` and `ys[0:j]` are rotated, the two
+ * halves are merged independently by recursion. Each thread finally merges its part by `InplaceMerge`, with keys
+ * collected from the part, so that merging takes linear time as a whole.
+ *
+ * @param xs
+ *   @pre xs <= ys
+ * @param ys
+ *   @pre ys <= ys_last
+ * @param ys_last
+ * @param comp
+ * @param num_threads
+ *   @pre num_threads >= 1
+ */
+template <typename Iterator, typename Compare>
+void ParallelMerge(Iterator xs, Iterator ys, Iterator ys_last, Compare comp, unsigned num_threads) {
+    diff_t<Iterator> xs_len = ys - xs;
+    diff_t<Iterator> ys_len = ys_last - ys;
+    if (num_threads <= 1 || xs_len + ys_len < kMinParallelSeqLen * 2 || !xs_len || !ys_len) {
+        return InplaceMerge(xs, ys, ys_last, comp);
+    }
+    if (!comp(*ys, *(ys - 1))) {
+        return;
+    }
+
+    // Find the least `i` such that `ys[half_len - 1 - i] < xs[i]`
+    diff_t<Iterator> half_len = (xs_len + ys_len) / 2;
+    diff_t<Iterator> lo = half_len > ys_len ? half_len - ys_len : 0;
+    diff_t<Iterator> hi = half_len < xs_len ? half_len : xs_len;
+    while (lo < hi) {
+        diff_t<Iterator> i = lo + (hi - lo) / 2;
+        if (comp(ys[half_len - 1 - i], xs[i])) {
+            hi = i;
+        } else {
+            lo = i + 1;
+        }
+    }
+    Iterator xs_cut = xs + lo;
+    Iterator ys_cut = ys + (half_len - lo);
+    Iterator mid = xs + half_len;
+
+    ParallelRotate(xs_cut, ys, ys_cut, num_threads);
+
+    unsigned lower_threads = num_threads - num_threads / 2;
+    ParallelFor(2, 2, [&](std::size_t i) {
+        if (!i) {
+            ParallelMerge(xs, xs_cut, mid, comp, lower_threads);
+        } else {
+            ParallelMerge(mid, mid + (ys - xs_cut), ys_last, comp, num_threads - lower_threads);
+        }
+    });
+}
+
+/**
+ * @brief Sort data stably by multiple threads.
+ *
+ * Data is divided into a power of 2 number of sequences, each of which is sorted by `Sort` concurrently, so that each
+ * thread owns the keys and the buffer collected from its own sequence. Then pairs of adjacent sequences are merged
+ * concurrently, level by level. Top levels with fewer pairs than threads split each merge by `ParallelMerge`.
+ *
+ * @param first
+ * @param last
+ * @param comp
+ * @param num_threads
+ *   @pre num_threads >= 1
+ */
+template <typename Iterator, typename Compare>
+void ParallelSort(Iterator first, Iterator last, Compare comp, unsigned num_threads) {
+    diff_t<Iterator> len = last - first;
+
+    diff_t<Iterator> log2_num_seqs = 0;
+    while ((diff_t<Iterator>{1} << log2_num_seqs) < static_cast<diff_t<Iterator>>(num_threads) &&
+           ((len - 1) >> (log2_num_seqs + 1)) + 1 >= kMinParallelSeqLen) {
+        ++log2_num_seqs;
+    }
+    if (!log2_num_seqs) {
+        return Sort(first, last, comp);
+    }
+
+    std::size_t num_seqs = std::size_t{1} << log2_num_seqs;
+    diff_t<Iterator> seq_len = ((len - 1) >> log2_num_seqs) + 1;
+    std::vector<Iterator> bounds;
+    bounds.reserve(num_seqs + 1);
+    bounds.push_back(first);
+    SequenceDivider<diff_t<Iterator>> seq_div{len, log2_num_seqs};
+    do {
+        bounds.push_back(bounds.back() + (seq_len - seq_div.Next()));
+    } while (!seq_div.IsEnd());
+
+    ParallelFor(num_seqs, num_threads, [&](std::size_t i) { Sort(bounds[i], bounds[i + 1], comp); });
+
+    // When pairs are fewer than threads, each pair is merged by multiple threads
+    for (std::size_t step = 1; step < num_seqs; step *= 2) {
+        std::size_t num_pairs = num_seqs / step / 2;
+        unsigned threads_per_pair = num_pairs < num_threads ? static_cast<unsigned>(num_threads / num_pairs) : 1;
+        ParallelFor(num_pairs, num_threads, [&](std::size_t i) {
+            i *= step * 2;
+            ParallelMerge(bounds[i], bounds[i + step], bounds[i + step * 2], comp, threads_per_pair);
+        });
+    }
+}
+
+}  // namespace
+}  // namespace detail
+
+/**
+ * @brief Sort stably by multiple threads.
+ *
+ * @param num_threads Maximum number of threads to use, including the calling thread. If it's 0, the number of
+ *   hardware threads is used.
+ */
+template <typename RandomAccessIterator, typename Compare>
+void parallel_sort(RandomAccessIterator first, RandomAccessIterator last, Compare comp, unsigned num_threads) {
+    if (!num_threads) {
+        num_threads = std::thread::hardware_concurrency();
+    }
+    return detail::ParallelSort(first, last, comp, num_threads ? num_threads : 1);
+}
+
+template <typename RandomAccessIterator, typename Compare>
+void parallel_sort(RandomAccessIterator first, RandomAccessIterator last, Compare comp) {
+    return parallel_sort(first, last, comp, 0);
+}
+
+template <typename RandomAccessIterator>
+void parallel_sort(RandomAccessIterator first, RandomAccessIterator last) {
+    return parallel_sort(first, last, std::less<>{}, 0);
+}
+
+}  // namespace sayhisort
+
+#endif  // SAYHISORT_PARALLEL_H
@@ -2,6 +2,12 @@
 
 #include <array>
 #include <functional>
+#include <utility>
+#include <vector>
+
+struct ZeroSentinel {
+    friend constexpr bool operator==(const int* p, ZeroSentinel) { return *p == 0; }
+};
 
 int main() {
     constexpr std::array<int, 9> a = ([]() {
@@ -10,5 +16,73 @@ int main() {
         return pi;
     })();
     static_assert(a == std::array{1, 1, 2, 3, 4, 5, 5, 6, 9});
+
+    constexpr std::array<int, 12> b = ([]() {
+        std::array e{9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 1, 2};
+        sayhisort::adaptive_sort(e.begin(), e.end(), std::less<int>{});
+        return e;
+    })();
+    static_assert(b == std::array{0, 1, 1, 2, 2, 3, 4, 5, 6, 7, 8, 9});
+
+    constexpr std::array<int, 20> c = ([]() {
+        std::array f{2, 0, 1, 2, 0, 1, 2, 2, 0, 0, 1, 2, 1, 0, 2, 0, 1, 1, 2, 0};
+        sayhisort::sort(f.begin(), f.end(), std::less<int>{});
+        return f;
+    })();
+    static_assert(c == std::array{0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2});
+
+    constexpr sayhisort::sort_stats d = ([]() {
+        std::array g{3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5, 8, 9, 7, 9, 3, 2, 3, 8, 4};
+        sayhisort::sort_stats stats;
+        sayhisort::sort(g.begin(), g.end(), [](int x, int y) { return x < y; }, stats);
+        sayhisort::sort(g.begin(), g.end(), std::less<int>{}, stats);
+        return stats;
+    })();
+    static_assert(d.comparisons > 0 && d.collected_keys > 0 && d.partitions > 0);
+
+    constexpr std::array<std::pair<int, int>, 20> e = ([]() {
+        std::array<std::pair<int, int>, 20> h{};
+        for (int i = 0; i < 20; ++i) {
+            h[i] = {(i * 7) % 3, i};
+        }
+        sayhisort::ranges::sort(h, std::ranges::greater{}, &std::pair<int, int>::first);
+        return h;
+    })();
+    static_assert(e[0] == std::pair{2, 2} && e[5] == std::pair{2, 17} && e[6] == std::pair{1, 1} &&
+                  e[12] == std::pair{1, 19} && e[13] == std::pair{0, 0} && e[19] == std::pair{0, 18});
+
+    constexpr std::array<int, 13> f = ([]() {
+        std::array j{5, 3, 9, 7, 1, 8, 2, 6, 4, 0, 9, 9, 9};
+        const int* last = sayhisort::ranges::sort(j.data(), ZeroSentinel{});
+        return last == j.data() + 9 ? j : std::array<int, 13>{};
+    })();
+    static_assert(f == std::array{1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 9, 9, 9});
+
+    constexpr std::vector<int>::size_type g = ([]() {
+        std::vector<int> k{4, -2, 3, -1, 0};
+        auto it = sayhisort::ranges::sort(k, {}, [](int x) { return x * x; });
+        return it == k.end() && k == std::vector{0, -1, -2, 3, 4} ? k.size() : 0;
+    })();
+    static_assert(g == 5);
+
+    constexpr std::array<char, 12> h = ([]() {
+        std::array keys{5, 3, 5, 1, 2, 3, 4, 1, 5, 2, 4, 0};
+        std::array names{'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l'};
+        sayhisort::sort_columns(keys.begin(), keys.end(), std::less<>{}, names.begin());
+        return names;
+    })();
+    static_assert(h == std::array{'l', 'd', 'h', 'e', 'j', 'b', 'f', 'g', 'k', 'a', 'c', 'i'});
+
+    constexpr std::array<std::pair<int, int>, 40> i = ([]() {
+        std::array<std::pair<int, int>, 40> m{};
+        for (int k = 0; k < 40; ++k) {
+            m[k] = {k < 24 ? k : (k - 24) * 3 / 2, k};
+        }
+        sayhisort::inplace_merge(m.begin(), m.begin() + 24, m.end(),
+                                 [](const auto& x, const auto& y) { return x.first < y.first; });
+        return m;
+    })();
+    static_assert(i[0] == std::pair{0, 0} && i[1] == std::pair{0, 24} && i[2] == std::pair{1, 1} &&
+                  i[3] == std::pair{1, 25} && i[39] == std::pair{23, 23});
     return 0;
 }
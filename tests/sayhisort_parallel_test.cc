@@ -0,0 +1,137 @@
+#include "sayhisort_parallel.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using namespace sayhisort::detail;
+
+using Iterator = std::vector<int>::iterator;
+using Compare = std::less<int>;
+using SsizeT = Iterator::difference_type;
+
+struct CompareDiv4 {
+    bool operator()(int x, int y) const { return (x >> 2) < (y >> 2); }
+};
+
+std::mt19937_64 GetPerTestRNG() {
+    uint64_t h = 0xcbf29ce484222325;
+    auto fnv1a = [&h](const char* m) {
+        while (*m) {
+            h ^= *m++;
+            h *= 0x00000100000001b3;
+        }
+    };
+
+    int seed = testing::UnitTest::GetInstance()->random_seed();
+
+    char seed_hex[sizeof(int) * 2 + 2];
+    if (char* p = std::to_chars(std::begin(seed_hex), std::end(seed_hex), seed, 16).ptr; p > std::end(seed_hex) - 2) {
+        // should be unreachable, but just nul-terminate for safety
+        seed_hex[0] = '\0';
+    } else {
+        p[0] = '/';
+        p[1] = '\0';
+    }
+    fnv1a(std::begin(seed_hex));
+
+    const auto* test_info = testing::UnitTest::GetInstance()->current_test_info();
+    const char* suite_name = test_info->test_suite_name();
+    const char* test_name = test_info->name();
+    fnv1a(suite_name);
+    fnv1a("::");
+    fnv1a(test_name);
+
+    return std::mt19937_64{h};
+}
+
+TEST(SayhiSortTest, ParallelFor) {
+    std::vector<int> counts(100);
+    ParallelFor(counts.size(), 4, [&](std::size_t i) { ++counts[i]; });
+    EXPECT_EQ(counts, std::vector<int>(100, 1));
+
+    EXPECT_THROW(ParallelFor(10, 4, [](std::size_t i) { throw static_cast<int>(i); }), int);
+}
+
+TEST(SayhiSortTest, ParallelRotate) {
+    SsizeT ary_len = kMinParallelSeqLen * 5 + 3;
+    std::vector<int> data(ary_len);
+    std::vector<int> expected(ary_len);
+
+    for (SsizeT i : {SsizeT{0}, SsizeT{1}, kMinParallelSeqLen, ary_len / 2, ary_len - 1, ary_len}) {
+        for (unsigned num_threads : {1, 2, 5}) {
+            std::iota(data.begin(), data.end(), 0);
+            ParallelRotate(data.begin(), data.begin() + i, data.end(), num_threads);
+            std::iota(expected.begin() + ary_len - i, expected.end(), 0);
+            std::iota(expected.begin(), expected.begin() + ary_len - i, i);
+            EXPECT_EQ(data, expected) << i << " " << num_threads;
+        }
+    }
+}
+
+TEST(SayhiSortTest, ParallelMerge) {
+    SsizeT ary_len = kMinParallelSeqLen * 6;
+
+    std::vector<int> ary(ary_len);
+    std::vector<int> expected(ary_len);
+    auto rng = GetPerTestRNG();
+
+    for (SsizeT xs_len : {SsizeT{0}, SsizeT{10}, kMinParallelSeqLen, ary_len / 2, ary_len - 7}) {
+        for (unsigned num_threads : {1, 2, 3, 4}) {
+            Iterator xs = ary.begin();
+            Iterator ys = xs + xs_len;
+            Iterator ys_last = ary.end();
+
+            std::generate(ary.begin(), ary.end(), [&]() { return std::uniform_int_distribution<int>{0, 999}(rng); });
+            std::sort(xs, ys, Compare{});
+            std::sort(ys, ys_last, Compare{});
+
+            std::copy(ary.begin(), ary.end(), expected.begin());
+            std::stable_sort(expected.begin(), expected.end(), CompareDiv4{});
+            ParallelMerge(xs, ys, ys_last, CompareDiv4{}, num_threads);
+
+            EXPECT_EQ(ary, expected) << "xs_len=" << xs_len << " num_threads=" << num_threads;
+        }
+    }
+}
+
+TEST(SayhiSortTest, ParallelSort) {
+    SsizeT ary_len = 100000;
+    std::vector<int> ary(ary_len);
+    std::vector<int> expected(ary_len);
+
+    auto rng = GetPerTestRNG();
+
+    for (SsizeT i : {SsizeT{0}, SsizeT{100}, kMinParallelSeqLen * 2 - 1, kMinParallelSeqLen * 2, ary_len}) {
+        for (unsigned num_threads : {1, 2, 3, 8}) {
+            std::generate(ary.begin(), ary.begin() + i,
+                          [&]() { return std::uniform_int_distribution<int>{0, 999}(rng); });
+            std::copy(ary.begin(), ary.end(), expected.begin());
+            sayhisort::parallel_sort(ary.begin(), ary.begin() + i, CompareDiv4{}, num_threads);
+            std::stable_sort(expected.begin(), expected.begin() + i, CompareDiv4{});
+            EXPECT_EQ(ary, expected) << i << " " << num_threads;
+        }
+    }
+
+    std::shuffle(ary.begin(), ary.end(), rng);
+    std::copy(ary.begin(), ary.end(), expected.begin());
+    sayhisort::parallel_sort(ary.begin(), ary.end());
+    std::stable_sort(expected.begin(), expected.end());
+    EXPECT_EQ(ary, expected);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -10,6 +10,7 @@
 #include <numeric>
 #include <random>
 #include <set>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <vector>
@@ -89,6 +90,87 @@ TEST(SayhiSortTest, Rotate) {
     }
 }
 
+TEST(SayhiSortTest, RotateDispatch) {
+    auto expected = [](int l, int i) {
+        std::vector<int> v(l);
+        std::iota(v.begin() + l - i, v.end(), 0);
+        std::iota(v.begin(), v.begin() + l - i, i);
+        return v;
+    };
+
+    for (int l : {1, 2, 3, 31, 32, 300, 301}) {
+        for (int i = 0; i <= l; ++i) {
+            const std::vector<int> want = expected(l, i);
+            std::vector<int> data(l);
+            std::iota(data.begin(), data.end(), 0);
+            Rotate(data.begin(), data.begin() + i, data.end());
+            EXPECT_EQ(data, want);
+
+            // Non-trivially-copyable elements
+            std::vector<std::vector<int>> nested(l);
+            for (int j = 0; j < l; ++j) {
+                nested[j] = {j};
+            }
+            Rotate(nested.begin(), nested.begin() + i, nested.end());
+            for (int j = 0; j < l; ++j) {
+                EXPECT_EQ(nested[j], std::vector<int>{want[j]});
+            }
+
+            if (i == 0 || i == l) {
+                continue;
+            }
+            std::iota(data.begin(), data.end(), 0);
+            RotateTrinity(data.begin(), data.begin() + i, data.end());
+            EXPECT_EQ(data, want);
+            for (int j = 0; j < l; ++j) {
+                nested[j] = {j};
+            }
+            RotateTrinity(nested.begin(), nested.begin() + i, nested.end());
+            for (int j = 0; j < l; ++j) {
+                EXPECT_EQ(nested[j], std::vector<int>{want[j]});
+            }
+        }
+    }
+}
+
+TEST(SayhiSortTest, SwapRanges) {
+    // Overlapping ranges must behave as the sequential element-wise swaps
+    for (int dist : {1, 3, 8, 13, 64, 100}) {
+        for (int len : {0, 1, 7, 64, 100, 200}) {
+            std::vector<int> data(len + dist);
+            std::vector<int> expected(len + dist);
+            std::iota(data.begin(), data.end(), 0);
+            std::iota(expected.begin(), expected.end(), 0);
+            SwapRanges(data.begin() + dist, data.begin(), len);
+            for (int i = 0; i < len; ++i) {
+                std::swap(expected[dist + i], expected[i]);
+            }
+            EXPECT_EQ(data, expected);
+
+            std::iota(data.begin(), data.end(), 0);
+            std::iota(expected.begin(), expected.end(), 0);
+            SwapRangesBackward(data.end() - dist, data.end(), len);
+            for (int i = 1; i <= len; ++i) {
+                std::swap(expected[len - i], expected[len + dist - i]);
+            }
+            EXPECT_EQ(data, expected);
+
+            std::iota(data.begin(), data.end(), 0);
+            std::iota(expected.begin(), expected.end(), 0);
+            SwapRanges(data.rbegin() + dist, data.rbegin(), len);
+            for (int i = 0; i < len; ++i) {
+                std::swap(expected[len - 1 - i], expected[len + dist - 1 - i]);
+            }
+            EXPECT_EQ(data, expected);
+        }
+    }
+
+    // Non-trivially-copyable types take the element-wise path
+    std::vector<std::vector<int>> xs{{0}, {1}, {2}, {3}};
+    SwapRanges(xs.begin(), xs.begin() + 2, 2);
+    EXPECT_EQ(xs, (std::vector<std::vector<int>>{{2}, {3}, {0}, {1}}));
+}
+
 TEST(SayhiSortTest, BinarySearch) {
     std::vector<int> data(17);
     std::iota(data.begin(), data.end() - 1, 0);
@@ -105,6 +187,131 @@ TEST(SayhiSortTest, BinarySearch) {
     }
 }
 
+TEST(SayhiSortTest, ExponentialSearch) {
+    std::vector<int> data(41);
+    std::iota(data.begin(), data.end() - 1, 0);
+    for (int i = 0; i <= 40; ++i) {
+        for (int j = -1; j <= i; ++j) {
+            data[40] = j;
+            auto it = ExponentialSearch<false>(data.begin(), data.begin() + i, data.begin() + 40, Compare{});
+            SsizeT idx = it - data.begin();
+            EXPECT_EQ(idx, std::max(0, std::min(j, i)));
+            it = ExponentialSearch<true>(data.begin(), data.begin() + i, data.begin() + 40, Compare{});
+            idx = it - data.begin();
+            EXPECT_EQ(idx, std::min(j + 1, i));
+        }
+    }
+}
+
+TEST(SayhiSortTest, HwangLinSearch) {
+    std::vector<int> data(41);
+    std::iota(data.begin(), data.end() - 1, 0);
+    for (int i = 1; i <= 40; ++i) {
+        for (SsizeT num_keys : {1, 2, 3, 7, 40}) {
+            for (int j = -1; j <= i; ++j) {
+                data[40] = j;
+                auto it = HwangLinSearch<false>(data.begin(), data.begin() + i, data.begin() + 40, num_keys, Compare{});
+                SsizeT idx = it - data.begin();
+                EXPECT_EQ(idx, std::max(0, std::min(j, i)));
+                it = HwangLinSearch<true>(data.begin(), data.begin() + i, data.begin() + 40, num_keys, Compare{});
+                idx = it - data.begin();
+                EXPECT_EQ(idx, std::min(j + 1, i));
+            }
+        }
+    }
+}
+
+TEST(SayhiSortTest, BatchSearch) {
+    auto rng = GetPerTestRNG();
+
+    auto test = [&rng](auto value, auto comp) {
+        using T = decltype(value);
+        for (SsizeT len = 1; len <= 40; ++len) {
+            std::vector<T> keys(len);
+            for (T& x : keys) {
+                x = static_cast<T>(rng() % 8) - 4;
+            }
+            std::sort(keys.begin(), keys.end(), comp);
+            std::vector<T> probes(21);
+            for (T& x : probes) {
+                x = static_cast<T>(rng() % 10) - 5;
+            }
+
+            unsigned char out[21];
+            BatchSearch<false>(keys.begin(), keys.end(), probes.begin(), 21, out, comp);
+            for (SsizeT i = 0; i < 21; ++i) {
+                EXPECT_EQ(out[i], std::lower_bound(keys.begin(), keys.end(), probes[i], comp) - keys.begin());
+            }
+            BatchSearch<true>(keys.begin(), keys.end(), probes.begin(), 21, out, comp);
+            for (SsizeT i = 0; i < 21; ++i) {
+                EXPECT_EQ(out[i], std::upper_bound(keys.begin(), keys.end(), probes[i], comp) - keys.begin());
+            }
+        }
+    };
+
+    test(int32_t{}, std::less<>{});
+    test(uint32_t{}, std::less<uint32_t>{});
+    test(int64_t{}, std::greater<>{});
+    test(uint64_t{}, std::greater<uint64_t>{});
+    test(int{}, CompareDiv4{});
+}
+
+#if SAYHISORT_HAS_SIMD_LEAVES
+TEST(SayhiSortTest, SimdSearchKernel) {
+    auto rng = GetPerTestRNG();
+
+    // Every kernel the CPU supports, not only the dispatched one
+    auto test = [&rng](auto isa, auto value, auto comp) {
+        using T = decltype(value);
+        if constexpr (SimdSearchOps<isa, T>::kAvailable) {
+            if (CpuSimdIsa() < isa) {
+                return;
+            }
+            for (SsizeT len = SimdSearchOps<isa, T>::kLanes; len <= 100; ++len) {
+                // Include extreme values, which differ in sign bits
+                std::vector<T> keys(len);
+                for (T& x : keys) {
+                    x = rng() % 4 ? static_cast<T>(rng() % 16) : static_cast<T>(rng());
+                }
+                std::sort(keys.begin(), keys.end(), comp);
+                std::vector<T> probes = keys;
+                for (T& x : probes) {
+                    x = static_cast<T>(static_cast<std::make_unsigned_t<T>>(x) + rng() % 3 - 1);
+                }
+
+                std::vector<SsizeT> out(probes.size());
+                SimdSearchKernel<isa>::template SearchBatch<false>(keys.data(), len, probes.data(), len, out.data(),
+                                                                   comp);
+                for (SsizeT i = 0; i < len; ++i) {
+                    SsizeT expected = std::lower_bound(keys.begin(), keys.end(), probes[i], comp) - keys.begin();
+                    EXPECT_EQ(out[i], expected);
+                    EXPECT_EQ((SimdSearchKernel<isa>::template Search<false>(keys.data(), len, probes[i], comp)),
+                              expected);
+                }
+                SimdSearchKernel<isa>::template SearchBatch<true>(keys.data(), len, probes.data(), len, out.data(),
+                                                                  comp);
+                for (SsizeT i = 0; i < len; ++i) {
+                    SsizeT expected = std::upper_bound(keys.begin(), keys.end(), probes[i], comp) - keys.begin();
+                    EXPECT_EQ(out[i], expected);
+                    EXPECT_EQ((SimdSearchKernel<isa>::template Search<true>(keys.data(), len, probes[i], comp)),
+                              expected);
+                }
+            }
+        }
+    };
+
+    auto test_all = [&test](auto isa) {
+        test(isa, int32_t{}, std::less<>{});
+        test(isa, uint32_t{}, std::greater<>{});
+        test(isa, int64_t{}, std::greater<int64_t>{});
+        test(isa, uint64_t{}, std::less<uint64_t>{});
+    };
+    test_all(std::integral_constant<SimdIsa, SimdIsa::kSse41>{});
+    test_all(std::integral_constant<SimdIsa, SimdIsa::kAvx2>{});
+    test_all(std::integral_constant<SimdIsa, SimdIsa::kAvx512>{});
+}
+#endif
+
 TEST(SayhiSortTest, MergeWithBuf) {
     SsizeT ary_len = 32;
 
@@ -112,7 +319,7 @@ TEST(SayhiSortTest, MergeWithBuf) {
     std::vector<int> rest_space(ary_len);
     std::vector<int> expected(ary_len);
 
-    auto naive_impl = [&](Iterator buf, Iterator xs, Iterator ys, Iterator ys_last, Compare comp) {
+    auto naive_impl = [&](Iterator buf, Iterator xs, Iterator ys, Iterator ys_last, auto comp) {
         SsizeT len = ys_last - buf;
         Iterator xs_last = ys;
 
@@ -150,27 +357,76 @@ TEST(SayhiSortTest, MergeWithBuf) {
     SsizeT buf_len = 8;
     auto rng = GetPerTestRNG();
 
-    for (SsizeT ys_len = 1; ys_len <= buf_len; ++ys_len) {
-        for (SsizeT xs_len = 1; xs_len <= ary_len - (buf_len + ys_len); ++xs_len) {
-            Iterator buf = ary.begin();
-            Iterator xs = buf + buf_len;
-            Iterator ys = xs + xs_len;
-            Iterator ys_last = ys + ys_len;
+    // The former is dispatched to the branchless kernel, whereas the latter isn't
+    static_assert(kIsCheapCompare<Iterator, Compare>);
+    auto opaque_comp = [](int x, int y) { return x < y; };
+    static_assert(!kIsCheapCompare<Iterator, decltype(opaque_comp)>);
+
+    auto test = [&](auto comp) {
+        for (SsizeT ys_len = 1; ys_len <= buf_len; ++ys_len) {
+            for (SsizeT xs_len = 1; xs_len <= ary_len - (buf_len + ys_len); ++xs_len) {
+                Iterator buf = ary.begin();
+                Iterator xs = buf + buf_len;
+                Iterator ys = xs + xs_len;
+                Iterator ys_last = ys + ys_len;
+
+                std::fill(buf, xs, 0);
+                std::iota(xs, ys_last, 100);
+                std::fill(ys_last, ary.end(), 42);
+                std::shuffle(xs, ys_last, rng);
+                std::sort(xs, ys, Compare{});
+                std::sort(ys, ys_last, Compare{});
+
+                auto [buf_expected, xs_consumed_expected, rest_expected] = naive_impl(buf, xs, ys, ys_last, comp);
+                auto [xs_consumed, rest] = MergeWithBuf<false>(buf, xs, ys, ys_last, comp);
+
+                EXPECT_EQ(ary, expected) << "xs_len=" << xs_len << " ys_len=" << ys_len;
+                EXPECT_EQ(buf, buf_expected);
+                EXPECT_EQ(rest, rest_expected);
+                EXPECT_EQ(xs_consumed, xs_consumed_expected);
+            }
+        }
+    };
 
-            std::fill(buf, xs, 0);
-            std::iota(xs, ys_last, 100);
-            std::fill(ys_last, ary.end(), 42);
-            std::shuffle(xs, ys_last, rng);
-            std::sort(xs, ys, Compare{});
-            std::sort(ys, ys_last, Compare{});
+    test(Compare{});
+    test(opaque_comp);
+}
 
-            auto [buf_expected, xs_consumed_expected, rest_expected] = naive_impl(buf, xs, ys, ys_last, Compare{});
-            auto [xs_consumed, rest] = MergeWithBuf<false>(buf, xs, ys, ys_last, Compare{});
+TEST(SayhiSortTest, MergeWithBufGalloping) {
+    SsizeT buf_len = 256;
+    std::vector<int> ary(buf_len * 3);
+    std::vector<int> expected(buf_len * 2);
 
-            EXPECT_EQ(ary, expected) << "xs_len=" << xs_len << " ys_len=" << ys_len;
-            EXPECT_EQ(buf, buf_expected);
-            EXPECT_EQ(rest, rest_expected);
-            EXPECT_EQ(xs_consumed, xs_consumed_expected);
+    SsizeT num_comps = 0;
+    auto counting_comp = [&num_comps](int x, int y) {
+        ++num_comps;
+        return (x >> 2) < (y >> 2);
+    };
+
+    for (SsizeT cluster_len : {1, 2, 16, 32, 64, 128}) {
+        // xs and ys consist of interleaving clusters, which are sorted within each of xs and ys
+        Iterator buf = ary.begin();
+        Iterator xs = buf + buf_len;
+        Iterator ys = xs + buf_len;
+        Iterator ys_last = ary.end();
+        for (SsizeT i = 0; i < buf_len * 2; ++i) {
+            bool in_ys = i / cluster_len % 2;
+            SsizeT idx = i / cluster_len / 2 * cluster_len + i % cluster_len;
+            (in_ys ? ys : xs)[idx] = static_cast<int>(i);
+        }
+        std::merge(xs, ys, ys, ys_last, expected.begin(), CompareDiv4{});
+        bool xs_consumed_expected = !CompareDiv4{}(ys_last[-1], ys[-1]);
+
+        num_comps = 0;
+        auto [xs_consumed, rest] = MergeWithBuf<false>(buf, xs, ys, ys_last, counting_comp);
+
+        EXPECT_EQ(rest - buf, buf_len);
+        EXPECT_TRUE(std::equal(ary.begin(), buf, expected.begin())) << cluster_len;
+        EXPECT_TRUE(std::equal(rest, ys_last, expected.begin() + (buf - ary.begin()))) << cluster_len;
+        EXPECT_EQ(xs_consumed, xs_consumed_expected);
+        if (cluster_len >= 32) {
+            // Galloping saves most comparisons within long clusters
+            EXPECT_LT(num_comps, buf_len) << cluster_len;
         }
     }
 }
@@ -230,16 +486,227 @@ TEST(SayhiSortTest, MergeWithoutBuf) {
             std::sort(ys, ys_last, Compare{});
 
             auto [xs_consumed_expected, rest_expected] = naive_impl(xs, ys, ys_last, Compare{});
+            std::vector<int> input = ary;
             auto [xs_consumed, rest] = MergeWithoutBuf<false>(xs, ys, ys_last, Compare{});
 
             EXPECT_EQ(ary, expected) << "xs_len=" << xs_len << " ys_len=" << ys_len;
             EXPECT_EQ(rest, rest_expected);
             EXPECT_EQ(xs_consumed, xs_consumed_expected);
             EXPECT_EQ(rest, rest_expected);
+
+            ary = input;
+            MergeResult mr = MergeWithoutBuf<false, SearchKind::kBinary>(xs, ys, ys_last, Compare{});
+            EXPECT_EQ(ary, expected) << "xs_len=" << xs_len << " ys_len=" << ys_len << " binary";
+            EXPECT_EQ(mr.xs_consumed, xs_consumed_expected);
+            EXPECT_EQ(mr.rest, rest_expected);
+
+            ary = input;
+            mr = MergeWithoutBuf<false, SearchKind::kHwangLin>(xs, ys, ys_last, Compare{});
+            EXPECT_EQ(ary, expected) << "xs_len=" << xs_len << " ys_len=" << ys_len << " hwang_lin";
+            EXPECT_EQ(mr.xs_consumed, xs_consumed_expected);
+            EXPECT_EQ(mr.rest, rest_expected);
         }
     }
 }
 
+TEST(SayhiSortTest, MergeWithExtBuf) {
+    SsizeT ary_len = 24;
+    SsizeT buf_len = 24;
+
+    std::vector<int> ary(ary_len);
+    std::vector<int> buf(buf_len);
+    std::vector<int> expected(ary_len);
+    std::vector<int> expected_buf(buf_len);
+    auto rng = GetPerTestRNG();
+
+    for (SsizeT ys_len = 1; ys_len < ary_len; ++ys_len) {
+        for (SsizeT xs_len = 1; xs_len <= ary_len - ys_len; ++xs_len) {
+            Iterator xs = ary.begin();
+            Iterator ys = xs + xs_len;
+            Iterator ys_last = ys + ys_len;
+
+            std::iota(buf.begin(), buf.end(), 0);
+            std::iota(xs, ys_last, 100);
+            std::fill(ys_last, ary.end(), 42);
+            std::shuffle(xs, ys_last, rng);
+            std::sort(xs, ys, CompareDiv4{});
+            std::sort(ys, ys_last, CompareDiv4{});
+
+            std::copy(ary.begin(), ary.end(), expected.begin());
+            std::inplace_merge(expected.begin(), expected.begin() + xs_len, expected.begin() + xs_len + ys_len,
+                               CompareDiv4{});
+            MergeWithExtBuf(xs, ys, ys_last, buf.begin(), CompareDiv4{});
+
+            EXPECT_EQ(ary, expected) << "xs_len=" << xs_len << " ys_len=" << ys_len;
+            std::sort(buf.begin(), buf.end());
+            std::iota(expected_buf.begin(), expected_buf.end(), 0);
+            EXPECT_EQ(buf, expected_buf);
+        }
+    }
+}
+
+TEST(SayhiSortTest, MergeBidirectional) {
+    SsizeT ary_len = 24;
+
+    std::vector<int> ary(ary_len);
+    std::vector<int> out(ary_len);
+    std::vector<int> expected(ary_len);
+    std::vector<int> expected_rest(ary_len);
+    auto rng = GetPerTestRNG();
+
+    for (SsizeT ys_len = 1; ys_len < ary_len; ++ys_len) {
+        for (SsizeT xs_len = 1; xs_len <= ary_len - ys_len; ++xs_len) {
+            SsizeT len = xs_len + ys_len;
+            Iterator xs = ary.begin();
+            Iterator ys = xs + xs_len;
+            Iterator ys_last = ys + ys_len;
+
+            std::iota(out.begin(), out.end(), 0);
+            std::iota(xs, ys_last, 100);
+            std::fill(ys_last, ary.end(), 42);
+            std::shuffle(xs, ys_last, rng);
+            std::sort(xs, ys, CompareDiv4{});
+            std::sort(ys, ys_last, CompareDiv4{});
+
+            std::copy(ary.begin(), ary.end(), expected.begin());
+            std::inplace_merge(expected.begin(), expected.begin() + xs_len, expected.begin() + len, CompareDiv4{});
+            std::copy(expected.begin() + len, expected.end(), out.begin() + len);
+            MergeBidirectional(xs, ys, ys_last, out.begin(), CompareDiv4{});
+
+            EXPECT_EQ(out, expected) << "xs_len=" << xs_len << " ys_len=" << ys_len;
+            std::sort(ary.begin(), ary.begin() + len);
+            std::iota(expected_rest.begin(), expected_rest.begin() + len, 0);
+            std::fill(expected_rest.begin() + len, expected_rest.end(), 42);
+            EXPECT_EQ(ary, expected_rest);
+        }
+    }
+}
+
+TEST(SayhiSortTest, MergeInPlace) {
+    SsizeT ary_len = 300;
+
+    std::vector<int> ary(ary_len);
+    std::vector<int> expected(ary_len);
+    auto rng = GetPerTestRNG();
+
+    for (SsizeT xs_len : {0, 1, 7, 8, 9, 30, 150, 299}) {
+        for (SsizeT ys_len : {0, 1, 9, 40, 150}) {
+            if (xs_len + ys_len > ary_len) {
+                continue;
+            }
+            Iterator xs = ary.begin();
+            Iterator ys = xs + xs_len;
+            Iterator ys_last = ys + ys_len;
+
+            std::generate(ary.begin(), ary.end(), [&]() { return std::uniform_int_distribution<int>{0, 99}(rng); });
+            std::sort(xs, ys, Compare{});
+            std::sort(ys, ys_last, Compare{});
+
+            std::copy(ary.begin(), ary.end(), expected.begin());
+            std::stable_sort(expected.begin(), expected.begin() + xs_len + ys_len, CompareDiv4{});
+            MergeInPlace(xs, ys, ys_last, CompareDiv4{});
+
+            EXPECT_EQ(ary, expected) << "xs_len=" << xs_len << " ys_len=" << ys_len;
+        }
+    }
+}
+
+TEST(SayhiSortTest, MergeUnbalanced) {
+    SsizeT ary_len = 1000;
+
+    std::vector<int> ary(ary_len);
+    std::vector<int> expected(ary_len);
+    auto rng = GetPerTestRNG();
+
+    for (SsizeT xs_len : {0, 1, 3, 17, 500, 983, 999, 1000}) {
+        for (int max_value : {15, 3999}) {
+            Iterator xs = ary.begin();
+            Iterator ys = xs + xs_len;
+
+            std::generate(ary.begin(), ary.end(),
+                          [&]() { return std::uniform_int_distribution<int>{0, max_value}(rng); });
+            std::sort(xs, ys, Compare{});
+            std::sort(ys, ary.end(), Compare{});
+
+            std::copy(ary.begin(), ary.end(), expected.begin());
+            std::stable_sort(expected.begin(), expected.end(), CompareDiv4{});
+            MergeUnbalanced(xs, ys, ary.end(), CompareDiv4{});
+
+            EXPECT_EQ(ary, expected) << "xs_len=" << xs_len << " max_value=" << max_value;
+        }
+    }
+
+    // Comparisons are close to the lower bound, log2(binomial(n + m, m)), when m << n
+    for (SsizeT xs_len : {16, 128}) {
+        SsizeT num_comps = 0;
+        auto counting_comp = [&num_comps](int x, int y) {
+            ++num_comps;
+            return x < y;
+        };
+
+        std::generate(ary.begin(), ary.end(), [&]() { return std::uniform_int_distribution<int>{0, 99999}(rng); });
+        std::sort(ary.begin(), ary.end() - xs_len);
+        std::sort(ary.end() - xs_len, ary.end());
+        MergeUnbalanced(ary.begin(), ary.end() - xs_len, ary.end(), counting_comp);
+
+        EXPECT_TRUE(std::is_sorted(ary.begin(), ary.end()));
+        double lower_bound =
+            std::lgamma(ary_len + 1.0) - std::lgamma(xs_len + 1.0) - std::lgamma(ary_len - xs_len + 1.0);
+        EXPECT_LT(num_comps, 1.5 * lower_bound / std::log(2.0) + 2 * xs_len) << "xs_len=" << xs_len;
+    }
+}
+
+TEST(SayhiSortTest, InplaceMerge) {
+    SsizeT ary_len = 2000;
+
+    std::vector<int> ary(ary_len);
+    std::vector<int> expected(ary_len);
+    auto rng = GetPerTestRNG();
+
+    for (SsizeT len : {0, 1, 16, 17, 100, 2000}) {
+        for (SsizeT xs_len : {SsizeT{0}, SsizeT{1}, len / 8, len / 3, len / 2, len - len / 5, len - 1, len}) {
+            if (xs_len < 0 || xs_len > len) {
+                continue;
+            }
+            // Plenty of distinct values, few of them, and only the right sequence has many
+            for (int max_value : {99999, 31, -1}) {
+                Iterator xs = ary.begin();
+                Iterator ys = xs + xs_len;
+                Iterator ys_last = xs + len;
+
+                std::generate(xs, ys, [&]() {
+                    return std::uniform_int_distribution<int>{0, max_value < 0 ? 15 : max_value}(rng);
+                });
+                std::generate(ys, ys_last, [&]() {
+                    return std::uniform_int_distribution<int>{0, max_value < 0 ? 99999 : max_value}(rng);
+                });
+                std::sort(xs, ys, CompareDiv4{});
+                std::sort(ys, ys_last, CompareDiv4{});
+
+                std::copy(ary.begin(), ary.end(), expected.begin());
+                std::stable_sort(expected.begin(), expected.begin() + len, CompareDiv4{});
+                InplaceMerge(xs, ys, ys_last, CompareDiv4{});
+
+                EXPECT_EQ(ary, expected) << "len=" << len << " xs_len=" << xs_len << " max_value=" << max_value;
+            }
+        }
+    }
+
+    // Block merge takes O(N) comparisons
+    SsizeT num_comps = 0;
+    auto counting_comp = [&num_comps](int x, int y) {
+        ++num_comps;
+        return x < y;
+    };
+    std::iota(ary.begin(), ary.end(), 0);
+    std::shuffle(ary.begin(), ary.end(), rng);
+    std::sort(ary.begin(), ary.begin() + ary_len / 2);
+    std::sort(ary.begin() + ary_len / 2, ary.end());
+    InplaceMerge(ary.begin(), ary.begin() + ary_len / 2, ary.end(), counting_comp);
+    EXPECT_TRUE(std::is_sorted(ary.begin(), ary.end()));
+    EXPECT_LT(num_comps, 4 * ary_len);
+}
+
 TEST(SayhiSortTest, InterleaveBlocks) {
     SsizeT ary_len = 32;
 
@@ -458,6 +925,48 @@ TEST(SayhiSortTest, MergeBlocking) {
             EXPECT_EQ(ary, expected);
         }
     }
+
+    // Sequences of different numbers of blocks
+    for (SsizeT num_left_blocks : {1, 2, 5, 10}) {
+        for (bool has_buf : {true, false}) {
+            BlockingParam<SsizeT> p{12, 7, 3, 6};
+            SsizeT imit_len = p.num_blocks - 2;
+            SsizeT buf_len = p.block_len;
+
+            SsizeT lseq_len = (num_left_blocks - 1) * p.block_len + p.first_block_len;
+            SsizeT rseq_len = (p.num_blocks - num_left_blocks - 1) * p.block_len + p.last_block_len;
+            SsizeT ary_len = imit_len + buf_len + lseq_len + rseq_len;
+            std::vector<int> ary(ary_len);
+
+            Iterator imit = ary.begin();
+            Iterator buf = imit + imit_len;
+            Iterator lseq = buf + buf_len;
+            Iterator rseq = lseq + lseq_len;
+            Iterator rseq_last = rseq + rseq_len;
+
+            std::iota(imit, buf, 0);
+            std::fill(buf, lseq, 0);
+            std::iota(lseq, rseq_last, 100);
+            std::shuffle(lseq, rseq_last, rng);
+            std::sort(lseq, rseq, Compare{});
+            std::sort(rseq, rseq_last, Compare{});
+
+            if (has_buf) {
+                MergeBlocking<true>(imit, buf, lseq, p, num_left_blocks, Compare{});
+                EXPECT_EQ(buf, ary.end() - buf_len);
+            } else {
+                MergeBlocking<false>(imit, buf, lseq, p, num_left_blocks, Compare{});
+                Rotate(buf, lseq, ary.end());
+            }
+
+            std::vector<int> expected(ary_len);
+            std::iota(expected.begin(), expected.begin() + imit_len, 0);
+            std::iota(expected.begin() + imit_len, expected.end() - buf_len, 100);
+            std::fill(expected.end() - buf_len, expected.end(), 0);
+
+            EXPECT_EQ(ary, expected) << "num_left_blocks=" << num_left_blocks;
+        }
+    }
 }
 
 TEST(SayhiSortTest, ReverseCompare) {
@@ -559,6 +1068,97 @@ TEST(SayhiSortTest, Sort0To8) {
     }
 }
 
+TEST(SayhiSortTest, SortLeaves) {
+    auto rng = GetPerTestRNG();
+
+    auto test = [&rng](auto value, auto comp) {
+        using T = decltype(value);
+        using Comp = decltype(comp);
+        SsizeT max_seq_len = MaxLeafLen<typename std::vector<T>::iterator, Comp>();
+
+        for (SsizeT seq_len = 5; seq_len <= max_seq_len; ++seq_len) {
+            for (SsizeT log2_num_seqs = 0; log2_num_seqs <= 4; ++log2_num_seqs) {
+                SsizeT num_seqs = SsizeT{1} << log2_num_seqs;
+                SsizeT data_len = (seq_len - 1) * num_seqs + 1;
+                std::vector<T> ary(data_len + 1);
+                for (T& x : ary) {
+                    // Include extreme values, which are also used for padding
+                    x = rng() % 4 ? static_cast<T>(rng() % 16) : static_cast<T>(rng());
+                }
+                ary.back() = 42;
+                std::vector<T> expected = ary;
+
+                SequenceDivider<SsizeT> seq_div{data_len, log2_num_seqs};
+                for (auto it = expected.begin(); !seq_div.IsEnd();) {
+                    SsizeT len = seq_len - seq_div.Next();
+                    std::sort(it, it + len, comp);
+                    it += len;
+                }
+                SortLeaves(ary.begin(), seq_len, {data_len, log2_num_seqs}, comp);
+                EXPECT_EQ(ary, expected) << "seq_len=" << seq_len << " num_seqs=" << num_seqs;
+            }
+        }
+    };
+
+    test(int32_t{}, std::less<int32_t>{});
+    test(int32_t{}, std::greater<>{});
+    test(uint32_t{}, std::less<>{});
+    test(uint32_t{}, std::greater<uint32_t>{});
+    test(int64_t{}, std::less<>{});
+    test(int64_t{}, std::greater<int64_t>{});
+    test(uint64_t{}, std::less<uint64_t>{});
+    test(uint64_t{}, std::greater<>{});
+}
+
+#if SAYHISORT_HAS_SIMD_LEAVES
+TEST(SayhiSortTest, SimdSortLeavesFor) {
+    auto rng = GetPerTestRNG();
+
+    // Every kernel the CPU supports, not only the dispatched one
+    auto test = [&rng](auto isa, auto value, auto descending) {
+        using T = decltype(value);
+        if constexpr (SimdLeafOps<isa, T>::kAvailable) {
+            if (CpuSimdIsa() < isa) {
+                return;
+            }
+            for (SsizeT seq_len = 5; seq_len <= SAYHISORT_SIMD_LEAF_LEN; ++seq_len) {
+                SsizeT log2_num_seqs = 4;
+                SsizeT data_len = (seq_len << log2_num_seqs) - 5;
+                std::vector<T> ary(data_len + 1);
+                for (T& x : ary) {
+                    x = rng() % 4 ? static_cast<T>(rng() % 16) : static_cast<T>(rng());
+                }
+                ary.back() = 42;
+                std::vector<T> expected = ary;
+
+                SequenceDivider<SsizeT> seq_div{data_len, log2_num_seqs};
+                for (auto it = expected.begin(); !seq_div.IsEnd();) {
+                    SsizeT len = seq_len - seq_div.Next();
+                    if constexpr (descending) {
+                        std::sort(it, it + len, std::greater<>{});
+                    } else {
+                        std::sort(it, it + len);
+                    }
+                    it += len;
+                }
+                SimdSortLeavesFor<isa, descending>(ary.data(), seq_len, {data_len, log2_num_seqs});
+                EXPECT_EQ(ary, expected) << "isa=" << static_cast<int>(isa()) << " seq_len=" << seq_len;
+            }
+        }
+    };
+
+    auto test_all = [&test](auto isa) {
+        test(isa, int32_t{}, std::false_type{});
+        test(isa, uint32_t{}, std::true_type{});
+        test(isa, int64_t{}, std::true_type{});
+        test(isa, uint64_t{}, std::false_type{});
+    };
+    test_all(std::integral_constant<SimdIsa, SimdIsa::kSse41>{});
+    test_all(std::integral_constant<SimdIsa, SimdIsa::kAvx2>{});
+    test_all(std::integral_constant<SimdIsa, SimdIsa::kAvx512>{});
+}
+#endif
+
 TEST(SayhiSortTest, FirstShellSortGap) {
     SsizeT n;
     SsizeT gap;
@@ -676,6 +1276,83 @@ TEST(SayhiSortTest, CollectKeys) {
     }
 }
 
+TEST(SayhiSortTest, MergeFewUnique) {
+    SsizeT ary_len = 64;
+    std::vector<int> ary(ary_len);
+    std::vector<int> expected(ary_len);
+    auto rng = GetPerTestRNG();
+
+    // Elements are compared by x / ary_len, whereas x % ary_len distinguishes equivalent ones
+    auto comp = [ary_len](int x, int y) { return x / ary_len < y / ary_len; };
+
+    for (SsizeT num_keys = 1; num_keys <= 8; ++num_keys) {
+        std::vector<int> keys(num_keys);
+        for (SsizeT k = 0; k < num_keys; ++k) {
+            keys[k] = static_cast<int>(k * ary_len);
+        }
+
+        for (SsizeT xs_len = 1; xs_len < ary_len; ++xs_len) {
+            for (SsizeT i = 0; i < ary_len; ++i) {
+                ary[i] = static_cast<int>(rng() % num_keys * ary_len + i);
+            }
+            std::stable_sort(ary.begin(), ary.begin() + xs_len, comp);
+            std::stable_sort(ary.begin() + xs_len, ary.end(), comp);
+            std::copy(ary.begin(), ary.end(), expected.begin());
+            std::stable_sort(expected.begin(), expected.end(), comp);
+
+            MergeFewUnique(ary.begin(), ary.begin() + xs_len, ary.end(), keys.begin(), keys.end(), comp);
+            EXPECT_EQ(ary, expected) << "num_keys=" << num_keys << " xs_len=" << xs_len;
+        }
+    }
+}
+
+TEST(SayhiSortTest, CountingSortFewUnique) {
+    SsizeT ary_len = kFewUniqueLeafLen;
+    std::vector<int> ary(ary_len);
+    std::vector<int> expected(ary_len);
+    auto rng = GetPerTestRNG();
+
+    auto comp = [ary_len](int x, int y) { return x / ary_len < y / ary_len; };
+
+    for (SsizeT num_keys : {1, 2, 5, kMaxFewUniqueKeys}) {
+        std::vector<int> keys(num_keys);
+        for (SsizeT k = 0; k < num_keys; ++k) {
+            keys[k] = static_cast<int>(k * ary_len);
+        }
+
+        for (SsizeT len : {1, 2, 100, kFewUniqueLeafLen}) {
+            for (SsizeT i = 0; i < ary_len; ++i) {
+                ary[i] = static_cast<int>(rng() % num_keys * ary_len + i);
+            }
+            std::copy(ary.begin(), ary.end(), expected.begin());
+            std::stable_sort(expected.begin(), expected.begin() + len, comp);
+
+            CountingSortFewUnique(ary.begin(), len, keys.begin(), keys.end(), comp);
+            EXPECT_EQ(ary, expected) << "num_keys=" << num_keys << " len=" << len;
+        }
+    }
+}
+
+TEST(SayhiSortTest, SortFewUnique) {
+    SsizeT ary_len = 5000;
+    std::vector<int> ary(ary_len);
+    std::vector<int> expected(ary_len);
+    auto rng = GetPerTestRNG();
+
+    for (SsizeT num_keys : {1, 2, 3, 7, 20, kMaxFewUniqueKeys - 1, kMaxFewUniqueKeys}) {
+        for (SsizeT len : {17, 100, 513, 1025, 5000}) {
+            for (SsizeT i = 0; i < len; ++i) {
+                ary[i] = static_cast<int>(rng() % num_keys * 4 * ary_len + i);
+            }
+            std::copy(ary.begin(), ary.end(), expected.begin());
+            auto comp = [ary_len](int x, int y) { return x / (4 * ary_len) < y / (4 * ary_len); };
+            std::stable_sort(expected.begin(), expected.begin() + len, comp);
+            sayhisort::sort(ary.begin(), ary.begin() + len, comp);
+            EXPECT_EQ(ary, expected) << "num_keys=" << num_keys << " len=" << len;
+        }
+    }
+}
+
 TEST(SayhiSortTest, MergeSortControl) {
     MergeSortControl<SsizeT> ctrl{8, 16};
 
@@ -724,6 +1401,20 @@ TEST(SayhiSortTest, MergeSortControl) {
     EXPECT_EQ(ctrl.seq_len, 477);
     EXPECT_EQ(ctrl.Next(), 0);
     EXPECT_EQ(ctrl.seq_len, 953);
+
+    // Longer leaves are allowed as long as they are bufferable
+    ctrl = {47, 953, 32};
+    EXPECT_EQ(ctrl.log2_num_seqs, 5);
+    EXPECT_EQ(ctrl.seq_len, 30);
+    EXPECT_LE(ctrl.seq_len, ctrl.bufferable_len);
+
+    ctrl = {8, 953, 32};
+    EXPECT_EQ(ctrl.bufferable_len, 12);
+    EXPECT_EQ(ctrl.seq_len, 8);
+
+    ctrl = {0, 953, 16};
+    EXPECT_EQ(ctrl.log2_num_seqs, 6);
+    EXPECT_EQ(ctrl.seq_len, 15);
 }
 
 TEST(SayhiSortTest, DetermineBlocking) {
@@ -788,6 +1479,335 @@ TEST(SayhiSortTest, Sort) {
     }
 }
 
+TEST(SayhiSortTest, SortWithExtBuf) {
+    SsizeT ary_len = 1024;
+    std::vector<int> ary(ary_len);
+    std::vector<int> expected(ary_len);
+    std::vector<int> buf(ary_len);
+    std::vector<int> expected_buf(ary_len);
+
+    auto rng = GetPerTestRNG();
+
+    for (SsizeT i : {9, 17, 100, 255, 256, 1000, 1024}) {
+        for (SsizeT buf_len : {SsizeT{0}, SsizeT{5}, SsizeT{32}, i / 4, i / 2, i / 2 + 1, i}) {
+            int max_val = rng() % 2 ? 99 : 4 * ary_len;
+            std::generate(ary.begin(), ary.begin() + i,
+                          [&]() { return std::uniform_int_distribution<int>{0, max_val}(rng); });
+            std::fill(ary.begin() + i, ary.end(), 8 * ary_len);
+            std::copy(ary.begin(), ary.end(), expected.begin());
+            std::iota(buf.begin(), buf.end(), -ary_len);
+            sayhisort::sort(ary.begin(), ary.begin() + i, buf.begin(), buf.begin() + buf_len, CompareDiv4{});
+            std::stable_sort(expected.begin(), expected.begin() + i, CompareDiv4{});
+            EXPECT_EQ(ary, expected) << i << " " << buf_len;
+
+            std::sort(buf.begin(), buf.begin() + buf_len);
+            std::iota(expected_buf.begin(), expected_buf.end(), -ary_len);
+            EXPECT_EQ(buf, expected_buf) << i << " " << buf_len;
+        }
+    }
+
+    std::iota(ary.begin(), ary.end(), 0);
+    std::shuffle(ary.begin(), ary.end(), rng);
+    sayhisort::sort(ary.begin(), ary.end(), buf.begin(), buf.end());
+    EXPECT_TRUE(std::is_sorted(ary.begin(), ary.end()));
+}
+
+TEST(SayhiSortTest, AdaptiveSort) {
+    SsizeT ary_len = 1000;
+    std::vector<int> ary(ary_len);
+    std::vector<int> expected(ary_len);
+
+    auto rng = GetPerTestRNG();
+    auto gen = [&]() { return std::uniform_int_distribution<int>{0, 399}(rng); };
+
+    auto check = [&](SsizeT len, const char* pattern) {
+        std::fill(ary.begin() + len, ary.end(), 1000);
+        std::copy(ary.begin(), ary.end(), expected.begin());
+        AdaptiveSort(ary.begin(), ary.begin() + len, CompareDiv4{});
+        std::stable_sort(expected.begin(), expected.begin() + len, CompareDiv4{});
+        EXPECT_EQ(ary, expected) << pattern << " " << len;
+    };
+
+    for (SsizeT len : {0, 1, 8, 9, 17, 100, 999, 1000}) {
+        std::generate(ary.begin(), ary.begin() + len, gen);
+        check(len, "random");
+
+        std::generate(ary.begin(), ary.begin() + len, gen);
+        std::stable_sort(ary.begin(), ary.begin() + len, CompareDiv4{});
+        check(len, "sorted");
+
+        std::iota(ary.begin(), ary.begin() + len, 0);
+        std::reverse(ary.begin(), ary.begin() + len);
+        check(len, "reversed");
+
+        std::generate(ary.begin(), ary.begin() + len, gen);
+        for (SsizeT i = 0; i < len; i += len / 5 + 1) {
+            std::stable_sort(ary.begin() + i, ary.begin() + std::min(len, i + len / 5 + 1), CompareDiv4{});
+        }
+        check(len, "shards");
+
+        std::generate(ary.begin(), ary.begin() + len, gen);
+        std::stable_sort(ary.begin(), ary.begin() + len * 9 / 10, CompareDiv4{});
+        check(len, "appended");
+
+        std::generate(ary.begin(), ary.begin() + len, gen);
+        std::sort(ary.begin(), ary.begin() + len / 2, std::greater<int>{});
+        std::sort(ary.begin() + len / 2, ary.begin() + len);
+        check(len, "descending and ascending");
+    }
+
+    std::iota(ary.begin(), ary.end(), 0);
+    std::shuffle(ary.begin(), ary.end(), rng);
+    std::copy(ary.begin(), ary.end(), expected.begin());
+    sayhisort::adaptive_sort(ary.begin(), ary.end());
+    std::stable_sort(expected.begin(), expected.end());
+    EXPECT_EQ(ary, expected);
+
+    // Elements appended to sorted data are merged in O(N) comparisons, and so are a few long runs of distinct keys
+    SsizeT num_comps = 0;
+    auto counting_comp = [&num_comps](int x, int y) {
+        ++num_comps;
+        return x < y;
+    };
+    SsizeT large_len = 100000;
+    std::vector<int> large(large_len);
+    for (SsizeT num_appended : {1, 30, 300}) {
+        std::generate(large.begin(), large.end(), gen);
+        std::sort(large.begin(), large.end() - num_appended);
+        num_comps = 0;
+        AdaptiveSort(large.begin(), large.end(), counting_comp);
+        EXPECT_TRUE(std::is_sorted(large.begin(), large.end()));
+        EXPECT_LT(num_comps, 2 * large_len) << num_appended;
+    }
+    std::iota(large.begin(), large.end(), 0);
+    std::shuffle(large.begin(), large.end(), rng);
+    for (SsizeT i = 0; i < large_len; i += 20000) {
+        std::sort(large.begin() + i, large.begin() + i + 20000);
+    }
+    num_comps = 0;
+    AdaptiveSort(large.begin(), large.end(), counting_comp);
+    EXPECT_TRUE(std::is_sorted(large.begin(), large.end()));
+    EXPECT_LT(num_comps, 6 * large_len);
+}
+
+TEST(SayhiSortTest, PartitionBranchless) {
+    auto rng = GetPerTestRNG();
+
+    for (SsizeT len : {2, 3, 10, 1000}) {
+        std::vector<int> ary(len);
+        for (auto& x : ary) {
+            x = static_cast<int>(rng() % 10);
+        }
+        int pivot = ary[0];
+        std::multiset<int> expected(ary.begin(), ary.end());
+
+        std::vector<int> lt = ary;
+        auto lt_bound = PartitionBranchless<false>(lt.begin(), lt.end(), Compare{});
+        EXPECT_EQ(lt[0], pivot);
+        EXPECT_TRUE(std::all_of(lt.begin() + 1, lt_bound, [pivot](int x) { return x < pivot; }));
+        EXPECT_TRUE(std::all_of(lt_bound, lt.end(), [pivot](int x) { return x >= pivot; }));
+        EXPECT_EQ(std::multiset<int>(lt.begin(), lt.end()), expected);
+
+        std::vector<int> le = ary;
+        auto le_bound = PartitionBranchless<true>(le.begin(), le.end(), Compare{});
+        EXPECT_EQ(le[0], pivot);
+        EXPECT_TRUE(std::all_of(le.begin() + 1, le_bound, [pivot](int x) { return x <= pivot; }));
+        EXPECT_TRUE(std::all_of(le_bound, le.end(), [pivot](int x) { return x > pivot; }));
+        EXPECT_EQ(std::multiset<int>(le.begin(), le.end()), expected);
+    }
+}
+
+#if SAYHISORT_HAS_SIMD_LEAVES
+TEST(SayhiSortTest, SimdPartitionKernel) {
+    auto rng = GetPerTestRNG();
+
+    // Every kernel the CPU supports, not only the dispatched one
+    auto test = [&rng](auto isa, auto value, auto comp) {
+        using T = decltype(value);
+        if constexpr (SimdPartitionOps<isa, T>::kAvailable) {
+            if (CpuSimdIsa() < isa) {
+                return;
+            }
+            for (SsizeT len = 2 * SimdPartitionOps<isa, T>::kLanes; len <= 200; ++len) {
+                std::vector<T> ary(len);
+                for (T& x : ary) {
+                    x = rng() % 4 ? static_cast<T>(rng() % 16) : static_cast<T>(rng());
+                }
+                T pivot = ary[rng() % len];
+                std::multiset<T> expected(ary.begin(), ary.end());
+
+                std::vector<T> lt = ary;
+                SsizeT lt_bound = SimdPartitionKernel<isa>::template Run<false>(lt.data(), len, pivot, comp);
+                EXPECT_TRUE(std::all_of(lt.begin(), lt.begin() + lt_bound, [&](T x) { return comp(x, pivot); }));
+                EXPECT_TRUE(std::none_of(lt.begin() + lt_bound, lt.end(), [&](T x) { return comp(x, pivot); }));
+                EXPECT_EQ(std::multiset<T>(lt.begin(), lt.end()), expected);
+
+                std::vector<T> le = ary;
+                SsizeT le_bound = SimdPartitionKernel<isa>::template Run<true>(le.data(), len, pivot, comp);
+                EXPECT_TRUE(std::none_of(le.begin(), le.begin() + le_bound, [&](T x) { return comp(pivot, x); }));
+                EXPECT_TRUE(std::all_of(le.begin() + le_bound, le.end(), [&](T x) { return comp(pivot, x); }));
+                EXPECT_EQ(std::multiset<T>(le.begin(), le.end()), expected);
+            }
+        }
+    };
+
+    auto test_all = [&test](auto isa) {
+        test(isa, int32_t{}, std::less<>{});
+        test(isa, uint32_t{}, std::greater<>{});
+        test(isa, int64_t{}, std::greater<>{});
+        test(isa, uint64_t{}, std::less<>{});
+    };
+    test_all(std::integral_constant<SimdIsa, SimdIsa::kAvx2>{});
+    test_all(std::integral_constant<SimdIsa, SimdIsa::kAvx512>{});
+}
+#endif
+
+TEST(SayhiSortTest, IntroSort) {
+    auto rng = GetPerTestRNG();
+
+    for (SsizeT len : {0, 1, 5, 9, 33, 100, 1000, 100000}) {
+        for (int mod : {1, 3, 1000, 0}) {
+            std::vector<int> ary(len);
+            for (auto& x : ary) {
+                x = mod ? static_cast<int>(rng() % mod) : static_cast<int>(rng());
+            }
+            std::vector<int> expected = ary;
+            std::sort(expected.begin(), expected.end(), std::greater<>{});
+
+            // Sorted by quick sort, by `Sort` from the start, and by `Sort` in the middle
+            for (int depth_limit : {64, 0, 2}) {
+                std::vector<int> sorted = ary;
+                IntroSort(sorted.begin(), sorted.end(), std::greater<>{}, depth_limit);
+                EXPECT_EQ(sorted, expected);
+            }
+        }
+    }
+
+    // Ascending, descending and organ pipe
+    std::vector<int> ary(10000);
+    std::iota(ary.begin(), ary.end(), 0);
+    std::vector<int> expected = ary;
+    UnstableSort(ary.begin(), ary.end(), Compare{});
+    EXPECT_EQ(ary, expected);
+    std::reverse(ary.begin(), ary.end());
+    UnstableSort(ary.begin(), ary.end(), Compare{});
+    EXPECT_EQ(ary, expected);
+    std::reverse(ary.begin() + 5000, ary.end());
+    UnstableSort(ary.begin(), ary.end(), Compare{});
+    EXPECT_EQ(ary, expected);
+}
+
+TEST(SayhiSortTest, ApplyPermutation) {
+    auto rng = GetPerTestRNG();
+
+    for (SsizeT len : {1, 2, 7, 100, 1000}) {
+        std::vector<int> ary(len);
+        std::iota(ary.begin(), ary.end(), 100);
+        std::vector<std::pair<int, std::uint32_t>> perm(len);
+        for (SsizeT i = 0; i < len; ++i) {
+            perm[i].second = static_cast<std::uint32_t>(i);
+        }
+        std::shuffle(perm.begin(), perm.end(), rng);
+
+        std::vector<int> expected(len);
+        for (SsizeT i = 0; i < len; ++i) {
+            expected[i] = ary[perm[i].second];
+        }
+        ApplyPermutation(ary.begin(), perm.begin(), len);
+        EXPECT_EQ(ary, expected);
+        for (SsizeT i = 0; i < len; ++i) {
+            EXPECT_EQ(perm[i].second, static_cast<std::uint32_t>(i));
+        }
+    }
+}
+
+TEST(SayhiSortTest, SortByCachedKey) {
+    auto rng = GetPerTestRNG();
+
+    for (SsizeT len : {0, 1, 2, 10, 100, 1000, 10000}) {
+        std::vector<std::string> ary(len);
+        for (auto& x : ary) {
+            x = std::to_string(rng() % 1000) + "," + std::to_string(rng());
+        }
+        auto key_of = [](const std::string& x) { return std::stoi(x.substr(0, x.find(','))); };
+        std::vector<std::string> expected = ary;
+        std::stable_sort(expected.begin(), expected.end(),
+                         [&](const auto& x, const auto& y) { return key_of(x) < key_of(y); });
+
+        // Each key is computed once
+        std::vector<std::string> cached = ary;
+        SsizeT num_calls = 0;
+        sayhisort::sort_by_cached_key(cached.begin(), cached.end(), [&](const std::string& x) {
+            ++num_calls;
+            return key_of(x);
+        });
+        EXPECT_EQ(cached, expected);
+        EXPECT_EQ(num_calls, len > 1 ? len : 0);
+
+        for (std::ptrdiff_t max_cached_keys : {1, 3, 64}) {
+            std::vector<std::string> bounded = ary;
+            sayhisort::sort_by_cached_key(bounded.begin(), bounded.end(), key_of, std::greater<>{}, max_cached_keys);
+            std::vector<std::string> reversed = ary;
+            std::stable_sort(reversed.begin(), reversed.end(),
+                             [&](const auto& x, const auto& y) { return key_of(x) > key_of(y); });
+            EXPECT_EQ(bounded, reversed);
+        }
+    }
+}
+
+TEST(SayhiSortTest, ZipIterator) {
+    std::vector<int> keys{3, 1, 2};
+    std::vector<std::string> names{"c", "a", "b"};
+    using Zip = ZipIterator<std::vector<int>::iterator, std::vector<std::string>::iterator>;
+    Zip first{keys.begin(), names.begin()};
+    Zip last = first + 3;
+
+    EXPECT_EQ(last - first, 3);
+    EXPECT_TRUE(first < last);
+    EXPECT_EQ(std::get<1>(first[2].refs), "b");
+
+    swap(*first, first[1]);
+    EXPECT_EQ(keys, (std::vector{1, 3, 2}));
+    EXPECT_EQ(names, (std::vector<std::string>{"a", "c", "b"}));
+
+    RotateValues(first, first + 1, first + 2);
+    EXPECT_EQ(keys, (std::vector{3, 2, 1}));
+    EXPECT_EQ(names, (std::vector<std::string>{"c", "b", "a"}));
+
+    auto rev_first = std::make_reverse_iterator(last);
+    SwapRanges(rev_first, rev_first + 2, 1);
+    EXPECT_EQ(keys, (std::vector{1, 2, 3}));
+    EXPECT_EQ(names, (std::vector<std::string>{"a", "b", "c"}));
+
+    Rotate(first, first + 1, last);
+    EXPECT_EQ(keys, (std::vector{2, 3, 1}));
+    EXPECT_EQ(names, (std::vector<std::string>{"b", "c", "a"}));
+}
+
+TEST(SayhiSortTest, SortColumns) {
+    auto rng = GetPerTestRNG();
+
+    for (SsizeT len : {0, 1, 5, 8, 20, 100, 1000, 100000}) {
+        std::vector<int> keys(len);
+        std::vector<double> values(len);
+        std::vector<std::string> names(len);
+        std::vector<std::tuple<int, double, std::string>> expected(len);
+        for (SsizeT i = 0; i < len; ++i) {
+            keys[i] = static_cast<int>(rng() % 100);
+            values[i] = static_cast<double>(i);
+            names[i] = std::to_string(i);
+            expected[i] = {keys[i], values[i], names[i]};
+        }
+        std::stable_sort(expected.begin(), expected.end(),
+                         [](const auto& x, const auto& y) { return std::get<0>(x) < std::get<0>(y); });
+
+        sayhisort::sort_columns(keys.begin(), keys.end(), std::less<>{}, values.begin(), names.begin());
+        for (SsizeT i = 0; i < len; ++i) {
+            EXPECT_EQ(std::tie(keys[i], values[i], names[i]), expected[i]);
+        }
+    }
+}
+
 TEST(SayhiSortTest, SortAPI) {
     SsizeT ary_len = 100;
     std::vector<int> ary(ary_len);
@@ -801,6 +1821,178 @@ TEST(SayhiSortTest, SortAPI) {
     sayhisort::sort(ary.begin(), ary.end());
     std::stable_sort(expected.begin(), expected.end());
     EXPECT_EQ(ary, expected);
+
+    std::iota(ary.begin(), ary.end() - 5, 0);
+    std::copy(expected.begin() + 40, expected.begin() + 45, ary.end() - 5);
+    std::copy(ary.begin(), ary.end(), expected.begin());
+    sayhisort::inplace_merge_unbalanced(ary.begin(), ary.end() - 5, ary.end());
+    std::inplace_merge(expected.begin(), expected.end() - 5, expected.end());
+    EXPECT_EQ(ary, expected);
+
+    std::shuffle(ary.begin(), ary.end(), rng);
+    std::sort(ary.begin(), ary.begin() + 60);
+    std::sort(ary.begin() + 60, ary.end());
+    std::copy(ary.begin(), ary.end(), expected.begin());
+    sayhisort::inplace_merge(ary.begin(), ary.begin() + 60, ary.end());
+    std::inplace_merge(expected.begin(), expected.begin() + 60, expected.end());
+    EXPECT_EQ(ary, expected);
+}
+
+TEST(SayhiSortTest, SortStats) {
+    SsizeT ary_len = 10000;
+    std::vector<int> ary(ary_len);
+    std::vector<int> expected(ary_len);
+
+    auto rng = GetPerTestRNG();
+
+    std::iota(ary.begin(), ary.end(), 0);
+    std::shuffle(ary.begin(), ary.end(), rng);
+    std::copy(ary.begin(), ary.end(), expected.begin());
+
+    // Comparisons are the same as sorting without stats
+    std::uint64_t num_comps = 0;
+    std::vector<int> unobserved = ary;
+    sayhisort::sort(unobserved.begin(), unobserved.end(), [&num_comps](int x, int y) {
+        ++num_comps;
+        return CompareDiv4{}(x, y);
+    });
+
+    sayhisort::sort_stats stats;
+    sayhisort::sort(ary.begin(), ary.end(), CompareDiv4{}, stats);
+    std::stable_sort(expected.begin(), expected.end(), CompareDiv4{});
+    EXPECT_EQ(ary, expected);
+    EXPECT_EQ(ary, unobserved);
+    EXPECT_EQ(stats.comparisons, num_comps);
+    EXPECT_GT(stats.swaps, 0u);
+    EXPECT_GT(stats.rotations, 0u);
+    EXPECT_EQ(stats.collected_keys, static_cast<std::uint64_t>(2 * OverApproxSqrt(ary_len) - 2));
+    EXPECT_GT(stats.buffered_levels, 0u);
+    EXPECT_EQ(stats.skipped_levels, 0u);
+    EXPECT_EQ(stats.partitions, 0u);
+
+    // Keys are too few to buffer the top levels. Builtin operators would take the quick sort.
+    auto opaque_comp = [](int x, int y) { return x < y; };
+    sayhisort::sort_stats scarce_stats;
+    std::vector<int> scarce(100000);
+    for (auto& x : scarce) {
+        x = static_cast<int>(rng() % 200);
+    }
+    sayhisort::sort(scarce.begin(), scarce.end(), opaque_comp, scarce_stats);
+    EXPECT_TRUE(std::is_sorted(scarce.begin(), scarce.end()));
+    EXPECT_EQ(scarce_stats.collected_keys, 200u);
+    EXPECT_GT(scarce_stats.buffered_levels, 0u);
+    EXPECT_GT(scarce_stats.unbuffered_levels, 0u);
+
+    // Counters are accumulated. Few distinct keys skip block merging.
+    std::uint64_t prev_comps = stats.comparisons;
+    std::uint64_t prev_levels = stats.buffered_levels + stats.unbuffered_levels;
+    for (auto& x : ary) {
+        x %= 3;
+    }
+    sayhisort::sort(ary.begin(), ary.end(), opaque_comp, stats);
+    EXPECT_TRUE(std::is_sorted(ary.begin(), ary.end()));
+    EXPECT_GT(stats.comparisons, prev_comps);
+    EXPECT_EQ(stats.collected_keys, static_cast<std::uint64_t>(2 * OverApproxSqrt(ary_len) - 2 + 3));
+    EXPECT_EQ(stats.buffered_levels + stats.unbuffered_levels, prev_levels);
+    EXPECT_GT(stats.skipped_levels, 0u);
+
+    // Builtin operators take the quick sort, as they do without stats
+    std::vector<int> ints(ary_len);
+    for (auto& x : ints) {
+        x = static_cast<int>(rng() % 1000);
+    }
+    sayhisort::sort_stats quick_stats;
+    sayhisort::sort(ints.begin(), ints.end(), std::less<>{}, quick_stats);
+    EXPECT_TRUE(std::is_sorted(ints.begin(), ints.end()));
+    EXPECT_GT(quick_stats.comparisons, 0u);
+    EXPECT_GT(quick_stats.partitions, 0u);
+    EXPECT_EQ(quick_stats.collected_keys, 0u);
+    EXPECT_EQ(quick_stats.buffered_levels + quick_stats.unbuffered_levels + quick_stats.skipped_levels, 0u);
+}
+
+TEST(SayhiSortTest, SortPhaseListener) {
+    struct Listener {
+        void on_phase_begin(sayhisort::sort_phase phase, const sayhisort::sort_phase_info& info) {
+            EXPECT_FALSE(in_phase);
+            in_phase = true;
+            phases.push_back(phase);
+            infos.push_back(info);
+        }
+        void on_phase_end(sayhisort::sort_phase phase) {
+            EXPECT_TRUE(in_phase);
+            EXPECT_EQ(phase, phases.back());
+            in_phase = false;
+        }
+
+        bool in_phase = false;
+        std::vector<sayhisort::sort_phase> phases;
+        std::vector<sayhisort::sort_phase_info> infos;
+    };
+    using sayhisort::sort_phase;
+
+    auto rng = GetPerTestRNG();
+    // Builtin operators would take the quick sort
+    auto opaque_comp = [](int x, int y) { return x < y; };
+
+    for (SsizeT ary_len : {100, 10000, 100000}) {
+        std::vector<int> ary(ary_len);
+        for (auto& x : ary) {
+            x = static_cast<int>(rng() % 1000);
+        }
+        std::vector<int> expected = ary;
+        Listener listener;
+        sayhisort::sort(ary.begin(), ary.end(), opaque_comp, listener);
+        std::stable_sort(expected.begin(), expected.end());
+        EXPECT_EQ(ary, expected);
+        EXPECT_FALSE(listener.in_phase);
+
+        const auto& phases = listener.phases;
+        const auto& infos = listener.infos;
+        ASSERT_GE(phases.size(), 4u);
+        EXPECT_EQ(phases.front(), sort_phase::collect_keys);
+        EXPECT_EQ(infos.front().len, ary_len);
+        EXPECT_EQ(phases[1], sort_phase::sort_leaves);
+        EXPECT_EQ(phases.back(), sort_phase::merge_keys);
+        EXPECT_EQ(infos.back().len, ary_len);
+
+        // Merge levels double the sequence length
+        SsizeT seq_len = infos[1].seq_len;
+        for (std::size_t i = 2; i + 1 < phases.size(); ++i) {
+            if (phases[i] == sort_phase::redistribute_buffer) {
+                EXPECT_EQ(phases[i - 1], sort_phase::merge_level);
+                continue;
+            }
+            EXPECT_EQ(phases[i], sort_phase::merge_level);
+            EXPECT_LE(infos[i].seq_len - seq_len, 1);
+            EXPECT_GE(infos[i].num_blocks, 2);
+            EXPECT_GE(infos[i].block_len * (infos[i].num_blocks / 2), infos[i].seq_len);
+            seq_len = infos[i].seq_len * 2;
+        }
+        // The top level merges the whole data
+        EXPECT_GE(seq_len, infos[1].len);
+    }
+
+    // Few unique keys replace the following phases
+    std::vector<int> few(1000);
+    for (auto& x : few) {
+        x = static_cast<int>(rng() % 4);
+    }
+    Listener listener;
+    sayhisort::sort(few.begin(), few.end(), opaque_comp, listener);
+    EXPECT_TRUE(std::is_sorted(few.begin(), few.end()));
+    EXPECT_EQ(listener.phases, (std::vector{sort_phase::collect_keys, sort_phase::sort_few_unique}));
+
+    // The quick sort is reported as a whole
+    std::vector<int> ints(10000);
+    for (auto& x : ints) {
+        x = static_cast<int>(rng() % 1000);
+    }
+    Listener quick_listener;
+    sayhisort::sort(ints.begin(), ints.end(), std::less<>{}, quick_listener);
+    EXPECT_TRUE(std::is_sorted(ints.begin(), ints.end()));
+    EXPECT_FALSE(quick_listener.in_phase);
+    EXPECT_EQ(quick_listener.phases, std::vector{sort_phase::quick_sort});
+    EXPECT_EQ(quick_listener.infos.front().len, 10000);
 }
 
 }  // namespace